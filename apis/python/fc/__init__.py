@@ -1,4 +1,5 @@
 from .client import Client, fcache
 from .kv import KV
+from .server import Server
 
-__all__ = ['Client', 'fcache', 'KV']
\ No newline at end of file
+__all__ = ['Client', 'fcache', 'KV', 'Server']
\ No newline at end of file
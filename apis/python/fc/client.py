@@ -23,9 +23,9 @@ class Client:
     await self.ws.close()
  
 
-  async def sendCmd(self, data:bytearray, expectedRspBody: ResponseBody, allowDuplicate=False) -> Response.Response:
+  async def sendCmd(self, data:bytearray, expectedRspBody: ResponseBody, allowDuplicate=False, allowNotModified=False) -> Response.Response:
     rsp = await self.ws.query(data)
-    return raise_if_fail(rsp, expectedRspBody, allowDuplicate)
+    return raise_if_fail(rsp, expectedRspBody, allowDuplicate, allowNotModified)
     
   
   
@@ -15,6 +15,12 @@ def statusToString(status: Status.Status):
       return 'Command unknown'
     case Status.Status.Duplicate:
       return 'Duplicate'
+    case Status.Status.NotPermitted:
+      return 'Not Permitted'
+    case Status.Status.NotExist:
+      return 'Not Exist'
+    case Status.Status.NotModified:
+      return 'Not Modified'
 
 
 class FcException(Exception):
@@ -84,6 +90,8 @@ def createKvMap(kv: dict) -> bytearray:
           fb.TypedVectorFromElements(value)
         elif isinstance(value, list):
           _createTypedVector(fb, key, value)
+        elif isinstance(value, dict):
+          _createFieldMap(fb, key, value)
         else:          
           raise ValueError(f'Key {key}: has invalid value type')
     except:
@@ -112,6 +120,27 @@ def _createTypedVector(fb: FlexBuffers.Builder, key: str, items: list):
     fb.TypedVectorFromElements(items)
   
 
+def _createFieldMap(fb: FlexBuffers.Builder, key: str, fields: dict):
+  # stored as a hash on the server, where a field is a scalar or string
+  with fb.Map():
+    for name, value in fields.items():
+      if not isinstance(name, str):
+        raise ValueError(f'Key {key}: field name must be a string')
+      
+      fb.Key(name)
+
+      if isinstance(value, bool):
+        fb.Bool(value)
+      elif isinstance(value, int):
+        fb.Int(value)
+      elif isinstance(value, float):
+        fb.Float(value)
+      elif isinstance(value, str):
+        fb.String(value)
+      else:
+        raise ValueError(f'Key {key}: field {name} has invalid value type')
+
+
 # def createIntArray(items: list[int], unsigned=False):
 #   # q: int8, Q: uint8
 #   vec = array.array('Q' if unsigned else 'q')
@@ -143,16 +172,19 @@ def _raise_if_fail(rsp: bytes, expectedRspBody: ResponseBody, status=(Status.Sta
     raise ResponseError.disconnected()
   
 
-def raise_if_fail(rsp: bytes, expectedRspBody: ResponseBody, allowDuplicate=False) -> Response.Response:
+def raise_if_fail(rsp: bytes, expectedRspBody: ResponseBody, allowDuplicate=False, allowNotModified=False) -> Response.Response:
   """Confirm the response status is successful and the body type is expected.
   
   If status or body type checks fail, raise a ResponseError. Otherwise,
   return the deserialised Response object.
   """
+  status = (Status.Status.Ok,)
   if allowDuplicate:
-    return _raise_if_fail(rsp, expectedRspBody, status=(Status.Status.Ok, Status.Status.Duplicate))
-  else:
-    return _raise_if_fail(rsp, expectedRspBody, status=(Status.Status.Ok,))
+    status += (Status.Status.Duplicate,)
+  if allowNotModified:
+    status += (Status.Status.NotModified,)
+
+  return _raise_if_fail(rsp, expectedRspBody, status=status)
   
 
 def raise_if_empty (value: str):
@@ -1,3 +1,4 @@
+import array
 import flatbuffers
 import flatbuffers.flexbuffers
 import typing
@@ -14,15 +15,91 @@ from fc.fbs.fc.request import (Request, RequestBody, ClearOperation,
                                KVCount,
                                KVContains,
                                KVClear,
-                               KVClearSet)
-from fc.fbs.fc.response import (KVGet as KVGetRsp,
+                               KVClearSet,
+                               KVGroupInfo,
+                               KVIncr,
+                               KVDecr,
+                               KVAddFloat,
+                               KVCas,
+                               KVAppend,
+                               KVWriteAt,
+                               KVScan,
+                               KVGroupCreate,
+                               KVGetPrefix,
+                               KVRangeKeys,
+                               KVChunkBegin,
+                               KVChunkAppend,
+                               KVChunkCommit,
+                               KVChunkGet,
+                               KVGroupKeys,
+                               KVGetGroups,
+                               KVAggregate,
+                               AggregateOp,
+                               KVGroupSwap,
+                               KVInfo,
+                               KVFieldSet,
+                               KVFieldGet,
+                               KVFieldIncr,
+                               KVBitSet,
+                               KVBitTest,
+                               KVBitCount,
+                               KVBitOp,
+                               BitOp,
+                               KVHllAdd,
+                               KVHllCount,
+                               KVHllMerge,
+                               KVNearest,
+                               Metric)
+from fc.fbs.fc.response import (Status,
+                                KVGet as KVGetRsp,
                                 KVCount as KVCountRsp,
-                                KVContains as KVContainsRsp)
+                                KVContains as KVContainsRsp,
+                                KVGroupInfo as KVGroupInfoRsp,
+                                KVIncr as KVIncrRsp,
+                                KVDecr as KVDecrRsp,
+                                KVAddFloat as KVAddFloatRsp,
+                                KVCas as KVCasRsp,
+                                KVAppend as KVAppendRsp,
+                                KVWriteAt as KVWriteAtRsp,
+                                KVScan as KVScanRsp,
+                                KVGetPrefix as KVGetPrefixRsp,
+                                KVRangeKeys as KVRangeKeysRsp,
+                                KVChunkBegin as KVChunkBeginRsp,
+                                KVChunkAppend as KVChunkAppendRsp,
+                                KVChunkGet as KVChunkGetRsp,
+                                KVGetGroups as KVGetGroupsRsp,
+                                KVAggregate as KVAggregateRsp,
+                                KVInfo as KVInfoRsp,
+                                KVFieldGet as KVFieldGetRsp,
+                                KVFieldIncr as KVFieldIncrRsp,
+                                KVBitSet as KVBitSetRsp,
+                                KVBitTest as KVBitTestRsp,
+                                KVBitCount as KVBitCountRsp,
+                                KVBitOp as KVBitOpRsp,
+                                KVHllAdd as KVHllAddRsp,
+                                KVHllCount as KVHllCountRsp,
+                                KVHllMerge as KVHllMergeRsp,
+                                KVNearest as KVNearestRsp)
 
 
 class KV:
   "Key Value API. If a response returns a fail, a ResponseError is raised."
 
+  # FlexBuffer value type to the name returned by info()
+  _value_types = {flatbuffers.flexbuffers.Type.INT: 'int',
+                  flatbuffers.flexbuffers.Type.UINT: 'uint',
+                  flatbuffers.flexbuffers.Type.FLOAT: 'float',
+                  flatbuffers.flexbuffers.Type.BOOL: 'bool',
+                  flatbuffers.flexbuffers.Type.STRING: 'str',
+                  flatbuffers.flexbuffers.Type.BLOB: 'blob',
+                  flatbuffers.flexbuffers.Type.VECTOR_INT: 'int_list',
+                  flatbuffers.flexbuffers.Type.VECTOR_UINT: 'uint_list',
+                  flatbuffers.flexbuffers.Type.VECTOR_FLOAT: 'float_list',
+                  flatbuffers.flexbuffers.Type.VECTOR_BOOL: 'bool_list',
+                  flatbuffers.flexbuffers.Type.VECTOR_KEY: 'str_list',
+                  flatbuffers.flexbuffers.Type.MAP: 'hash'}
+
+
   def __init__(self, client: Client):
     self.client = client
 
@@ -59,6 +136,52 @@ class KV:
     return await self._do_get(group=group)
 
 
+  async def get_groups(self, groups:dict) -> dict:
+    """Get keys from multiple groups in one request.
+
+    @param: groups A dict of group:keys. If keys is empty or None, all keys in the group are returned.
+                   The group name "" is keys not in a group.
+
+    Returns a dict of group:dict of key:value. Groups that don't exist are not in the result.
+    """
+    raise_if(len(groups) == 0, 'groups is empty')
+
+    fb = flatbuffers.Builder(initialSize=1024)
+
+    groupOffsets = []
+    for group, keys in groups.items():
+      groupOffset = fb.CreateString(group) if group else None
+      keysOffset = self._create_key_strings(fb, keys) if keys else None
+
+      KVGroupKeys.Start(fb)
+      if groupOffset:
+        KVGroupKeys.AddGroup(fb, groupOffset)
+      if keysOffset:
+        KVGroupKeys.AddKeys(fb, keysOffset)
+      groupOffsets.append(KVGroupKeys.End(fb))
+
+    fb.StartVector(4, len(groupOffsets), 4)
+    for off in reversed(groupOffsets):
+      fb.PrependUOffsetTRelative(off)
+    groupsOffset = fb.EndVector()
+
+    KVGetGroups.Start(fb)
+    KVGetGroups.AddGroups(fb, groupsOffset)
+    body = KVGetGroups.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVGetGroups)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVGetGroups)
+    union_body = KVGetGroupsRsp.KVGetGroups()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+
+    result = flatbuffers.flexbuffers.Loads(union_body.KvAsNumpy().tobytes())
+    for i in range(union_body.EncodedLength()):
+      group = union_body.Encoded(i).decode()
+      self._decode(result[group], True)
+    return result
+
+
   async def get_key(self, key:str, group:str = None) -> Any:
     raise_if(len(key) == 0, 'key is empty')
     return await self._do_get(key=key, group=group)
@@ -165,7 +288,874 @@ class KV:
     await self._do_set_add(kv, RequestBody.RequestBody.KVClearSet, group)
     
 
+  async def create_group(self, group:str, *, ordered:bool = False, encoded:bool = False, compressed:bool = False, reserve:int = 0, fail_on_duplicate:bool = True) -> None:
+    """Create a group. Groups are otherwise created when keys are first set, so this
+    is only required to set group options.
+
+    @param: ordered Keep an ordered index of keys, required for get_prefix() and range_keys().
+    @param: encoded Store string, blob and list values in wire format, so gets are faster but
+    sets are slower. These values can't be used with append(), write_at() or get_slices().
+    @param: compressed Compress large string and blob values. Can't be set with `encoded`.
+    @param: reserve The expected number of keys. The group is sized for this when created, so it
+    isn't rehashed as it grows to this size.
+    """
+    raise_if(len(group) == 0, 'group name cannot be empty')
+    raise_if(encoded and compressed, 'encoded and compressed cannot both be set')
+    raise_if(reserve < 0, 'reserve must be >= 0')
+
+    fb = flatbuffers.Builder(initialSize=128)
+    groupOffset = fb.CreateString(group)
+
+    KVGroupCreate.Start(fb)
+    KVGroupCreate.AddGroup(fb, groupOffset)
+    KVGroupCreate.AddOrdered(fb, ordered)
+    KVGroupCreate.AddEncoded(fb, encoded)
+    KVGroupCreate.AddCompressed(fb, compressed)
+    KVGroupCreate.AddReserve(fb, reserve)
+    body = KVGroupCreate.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVGroupCreate)
+    await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVGroupCreate, allowDuplicate=not fail_on_duplicate)
+
+
+  async def swap_groups(self, group:str, other:str, *, delete_other:bool = False) -> None:
+    """Exchange the keys and options of two groups, which is O(1). This allows a group to be 
+    rebuilt in a staging group, then made live in one step, so readers never see a partial group.
+
+    Both groups must exist, and can't have chunked uploads in progress.
+
+    @param: delete_other After the swap, delete `other`, which then has the previous keys of `group`.
+    """
+    raise_if(len(group) == 0 or len(other) == 0, 'group name cannot be empty')
+    raise_if(group == other, 'groups must be different')
+
+    fb = flatbuffers.Builder(initialSize=128)
+    groupOffset = fb.CreateString(group)
+    otherOffset = fb.CreateString(other)
+
+    KVGroupSwap.Start(fb)
+    KVGroupSwap.AddGroup(fb, groupOffset)
+    KVGroupSwap.AddOther(fb, otherOffset)
+    KVGroupSwap.AddDeleteOther(fb, delete_other)
+    body = KVGroupSwap.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVGroupSwap)
+    await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVGroupSwap)
+
+
+  async def get_prefix(self, prefix:str, *, group:str, keys_only:bool = False, limit:int = 0) -> dict | list:
+    """Get keys which start with `prefix`, in key order. The group must be ordered.
+
+    @param: keys_only Return a list of keys rather than a dict of key:value.
+    @param: limit Max keys returned, 0 is no limit.
+    """
+    raise_if(len(group) == 0, 'group name cannot be empty')
+    raise_if(limit < 0, 'limit must be >= 0')
+
+    fb = flatbuffers.Builder(initialSize=256)
+    groupOffset = fb.CreateString(group)
+    prefixOffset = fb.CreateString(prefix)
+
+    KVGetPrefix.Start(fb)
+    KVGetPrefix.AddGroup(fb, groupOffset)
+    KVGetPrefix.AddPrefix(fb, prefixOffset)
+    KVGetPrefix.AddKeysOnly(fb, keys_only)
+    KVGetPrefix.AddLimit(fb, limit)
+    body = KVGetPrefix.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVGetPrefix)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVGetPrefix)
+    union_body = KVGetPrefixRsp.KVGetPrefix()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return self._decode(flatbuffers.flexbuffers.Loads(union_body.KvAsNumpy().tobytes()), union_body.Encoded())
+
+
+  async def range_keys(self, start:str, end:str = None, *, group:str, limit:int = 0) -> list:
+    """Get keys in the range [start, end), in key order. If `end` is not set, the range is
+    to the last key. The group must be ordered.
+
+    @param: limit Max keys returned, 0 is no limit.
+    """
+    raise_if(len(group) == 0, 'group name cannot be empty')
+    raise_if(limit < 0, 'limit must be >= 0')
+
+    fb = flatbuffers.Builder(initialSize=256)
+    groupOffset = fb.CreateString(group)
+    startOffset = fb.CreateString(start)
+    if end:
+      endOffset = fb.CreateString(end)
+
+    KVRangeKeys.Start(fb)
+    KVRangeKeys.AddGroup(fb, groupOffset)
+    KVRangeKeys.AddStart(fb, startOffset)
+    if end:
+      KVRangeKeys.AddEnd(fb, endOffset)
+    KVRangeKeys.AddLimit(fb, limit)
+    body = KVRangeKeys.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVRangeKeys)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVRangeKeys)
+    union_body = KVRangeKeysRsp.KVRangeKeys()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return flatbuffers.flexbuffers.Loads(union_body.KeysAsNumpy().tobytes())
+
+
+  async def group_info(self, group:str = None) -> dict:
+    """Returns the key count and memory usage of `group`.
+
+    If `group` is not set, the info is for keys not in a group.
+    """
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=256)
+
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVGroupInfo.Start(fb)
+    if group:
+      KVGroupInfo.AddGroup(fb, groupOffset)
+    body = KVGroupInfo.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVGroupInfo)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVGroupInfo)
+    union_body = KVGroupInfoRsp.KVGroupInfo()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+
+    return {'count':union_body.Count(),
+            'bytes_used':union_body.BytesUsed(),
+            'bytes_reserved':union_body.BytesReserved(),
+            'ordered':union_body.Ordered(),
+            'encoded':union_body.Encoded(),
+            'compressed':union_body.Compressed(),
+            'compressed_bytes':union_body.CompressedBytes(),
+            'uncompressed_bytes':union_body.UncompressedBytes(),
+            'rehashes':union_body.Rehashes(),
+            'rehash_total_us':union_body.RehashTotalUs(),
+            'rehash_max_us':union_body.RehashMaxUs()}
+
+
+  async def incr(self, kv:dict, group:str = None) -> dict:
+    """Increment integer values by the amount in `kv`, i.e. {key:amount}.
+
+    Returns the new values. A key that does not exist is created with the amount.
+    """
+    raise_if(not all(isinstance(v, int) and not isinstance(v, bool) for v in kv.values()), 'amounts must be int')
+    return await self._do_add_numeric(kv, RequestBody.RequestBody.KVIncr, group)
+
+
+  async def decr(self, kv:dict, group:str = None) -> dict:
+    """Decrement integer values by the amount in `kv`, i.e. {key:amount}.
+
+    Returns the new values. A key that does not exist is created with the negated amount.
+    """
+    raise_if(not all(isinstance(v, int) and not isinstance(v, bool) for v in kv.values()), 'amounts must be int')
+    return await self._do_add_numeric(kv, RequestBody.RequestBody.KVDecr, group)
+
+
+  async def add_float(self, kv:dict, group:str = None) -> dict:
+    """Add the amount in `kv`, i.e. {key:amount}, to float values. The amount can be negative.
+
+    Returns the new values. A key that does not exist is created with the amount.
+    """
+    raise_if(not all(isinstance(v, (int, float)) and not isinstance(v, bool) for v in kv.values()), 'amounts must be float')
+    return await self._do_add_numeric({k:float(v) for k,v in kv.items()}, RequestBody.RequestBody.KVAddFloat, group)
+
+
+  async def get_slices(self, slices:dict, group:str = None) -> dict:
+    """Get part of string, blob and list values.
+
+    @param: slices key:[start] or key:[start, stop]. The range is the same as 
+            List get_range(), i.e. [start, stop) and can be negative. The range
+            is bytes for a string or blob, otherwise elements.
+    """
+    raise_if(len(slices) == 0, 'slices is empty')
+    raise_if(not all(isinstance(r, list) and len(r) in (1,2) and all(isinstance(i, int) for i in r) for r in slices.values()),
+              'slice must be [start] or [start, stop]')
+    return await self._do_get(keys=list(slices.keys()), group=group, slices=slices)
+
+
+  async def get_sizes(self, keys:typing.List[str] = None, group:str = None) -> dict:
+    """Get the size of values rather than the values: bytes for a string or blob,
+    elements for a list, otherwise 1.
+
+    If `keys` is not set, returns the size of all keys in `group`.
+    """
+    raise_if(keys is not None and len(keys) == 0, 'keys is empty')
+    raise_if(keys is None and group is None, 'keys or group must be set')
+    return await self._do_get(keys=keys, group=group, sizeOnly=True)
+
+
+  async def aggregate(self, op:str, keys:typing.List[str] = None, *, group:str = None, threshold:float = 0, operand:typing.List[float] = None) -> dict:
+    """Reduce int, uint and float list values to a scalar on the server, rather than getting the lists.
+
+    @param: op One of: 'sum', 'min', 'max', 'mean', 'count_above' (elements > `threshold`), 'dot' (dot product with `operand`)
+    @param: keys If not set, all keys in `group`. Values which aren't a numeric list are skipped.
+
+    Returns a dict of key:result.
+    """
+    ops = {'sum': AggregateOp.AggregateOp.Sum,
+           'min': AggregateOp.AggregateOp.Min,
+           'max': AggregateOp.AggregateOp.Max,
+           'mean': AggregateOp.AggregateOp.Mean,
+           'count_above': AggregateOp.AggregateOp.CountAbove,
+           'dot': AggregateOp.AggregateOp.Dot}
+
+    raise_if(op not in ops, 'op is invalid')
+    raise_if(keys is not None and len(keys) == 0, 'keys is empty')
+    raise_if(keys is None and group is None, 'keys or group must be set')
+    raise_if(op == 'dot' and not operand, 'operand must be set for dot')
+
+    fb = flatbuffers.Builder(initialSize=1024)
+
+    if keys:
+      keysOffset = self._create_key_strings(fb, keys)
+    if group:
+      groupOffset = fb.CreateString(group)
+    if operand:
+      fb.StartVector(8, len(operand), 8)
+      for v in reversed(operand):
+        fb.PrependFloat64(v)
+      operandOffset = fb.EndVector()
+
+    KVAggregate.Start(fb)
+    if keys:
+      KVAggregate.AddKeys(fb, keysOffset)
+    if group:
+      KVAggregate.AddGroup(fb, groupOffset)
+    if operand:
+      KVAggregate.AddOperand(fb, operandOffset)
+    KVAggregate.AddOp(fb, ops[op])
+    KVAggregate.AddThreshold(fb, threshold)
+    body = KVAggregate.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVAggregate)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVAggregate)
+    union_body = KVAggregateRsp.KVAggregate()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return flatbuffers.flexbuffers.Loads(union_body.KvAsNumpy().tobytes())
+
+
+  async def info(self, keys:typing.List[str] = None, group:str = None) -> dict:
+    """Get metadata for values without getting the values, i.e. to decide between `get_key()`, 
+    `get_slices()` or `get_chunked()`.
+
+    If `keys` is not set, returns info for all keys in `group`.
+
+    Returns key:dict, with:
+      - `type`: 'int', 'uint', 'float', 'bool', 'str', 'blob', 'hash', or for a list: 'int_list', 'uint_list', 'float_list', 'bool_list', 'str_list'
+      - `size`: as `get_sizes()`
+      - `bytes`: bytes stored for the value, which is the compressed size in a compressed group
+      - `version`: as `get_versions()`
+    """
+    raise_if(keys is not None and len(keys) == 0, 'keys is empty')
+    raise_if(keys is None and group is None, 'keys or group must be set')
+
+    fb = flatbuffers.Builder(initialSize=1024)
+
+    if keys:
+      keysOffset = self._create_key_strings(fb, keys)
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVInfo.Start(fb)
+    if keys:
+      KVInfo.AddKeys(fb, keysOffset)
+    if group:
+      KVInfo.AddGroup(fb, groupOffset)
+    body = KVInfo.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVInfo)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVInfo)
+    union_body = KVInfoRsp.KVInfo()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+
+    info = flatbuffers.flexbuffers.Loads(union_body.InfoAsNumpy().tobytes())
+    for keyInfo in info.values():
+      keyInfo['type'] = KV._value_types.get(keyInfo['type'], 'unknown')
+    return info
+
+
+  async def set_fields(self, key:str, fields:dict, group:str = None) -> None:
+    """Set fields of a hash value, i.e. one set with a dict. Only these fields are sent and changed.
+
+    The hash is created if `key` doesn't exist. A field value can be an int, float, bool or str.
+    """
+    raise_if(len(key) == 0, 'key is empty')
+    raise_if(len(fields) == 0, 'fields is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=256)
+    fieldsOffset, keyOffset, groupOffset = self._create_fields_request(fb, key, fields, group)
+
+    KVFieldSet.Start(fb)
+    KVFieldSet.AddKey(fb, keyOffset)
+    KVFieldSet.AddFields(fb, fieldsOffset)
+    if group:
+      KVFieldSet.AddGroup(fb, groupOffset)
+    body = KVFieldSet.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVFieldSet)
+    await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVFieldSet)
+
+
+  async def get_fields(self, key:str, fields:typing.List[str] = None, group:str = None) -> dict:
+    """Get fields of a hash value, or all fields if `fields` is not set.
+
+    Returns field:value. Fields which don't exist are not in the dict.
+    """
+    raise_if(len(key) == 0, 'key is empty')
+    raise_if(fields is not None and len(fields) == 0, 'fields is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=256)
+
+    keyOffset = fb.CreateString(key)
+    if fields:
+      fieldsOffset = self._create_key_strings(fb, fields)
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVFieldGet.Start(fb)
+    KVFieldGet.AddKey(fb, keyOffset)
+    if fields:
+      KVFieldGet.AddFields(fb, fieldsOffset)
+    if group:
+      KVFieldGet.AddGroup(fb, groupOffset)
+    body = KVFieldGet.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVFieldGet)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVFieldGet)
+    union_body = KVFieldGetRsp.KVFieldGet()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return flatbuffers.flexbuffers.Loads(union_body.FieldsAsNumpy().tobytes())
+
+
+  async def incr_fields(self, key:str, fields:dict, group:str = None) -> dict:
+    """Add to int or float fields of a hash value by the amount in `fields`, i.e. {field:amount}.
+
+    The hash and fields are created if they don't exist, with the amount. Returns the new values.
+    """
+    raise_if(len(key) == 0, 'key is empty')
+    raise_if(len(fields) == 0, 'fields is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=256)
+    fieldsOffset, keyOffset, groupOffset = self._create_fields_request(fb, key, fields, group)
+
+    KVFieldIncr.Start(fb)
+    KVFieldIncr.AddKey(fb, keyOffset)
+    KVFieldIncr.AddFields(fb, fieldsOffset)
+    if group:
+      KVFieldIncr.AddGroup(fb, groupOffset)
+    body = KVFieldIncr.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVFieldIncr)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVFieldIncr)
+    union_body = KVFieldIncrRsp.KVFieldIncr()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return flatbuffers.flexbuffers.Loads(union_body.FieldsAsNumpy().tobytes())
+
+
+  async def set_bits(self, key:str, bits:typing.List[int], value:bool = True, group:str = None) -> int:
+    """Set or clear bits of a bitmap, which is a blob value where bit n is bit (n % 8) of byte (n / 8).
+
+    The blob is created if `key` doesn't exist, and extended with zero bytes to include the highest bit.
+    A bitmap can be read with `get_key()` and set with `set()` as a `bytes` value.
+
+    Returns the number of bits which changed.
+    """
+    raise_if(len(key) == 0, 'key is empty')
+    raise_if(len(bits) == 0, 'bits is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=256)
+
+    keyOffset = fb.CreateString(key)
+    bitsOffset = self._create_bits(fb, bits)
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVBitSet.Start(fb)
+    KVBitSet.AddKey(fb, keyOffset)
+    KVBitSet.AddBits(fb, bitsOffset)
+    KVBitSet.AddValue(fb, value)
+    if group:
+      KVBitSet.AddGroup(fb, groupOffset)
+    body = KVBitSet.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVBitSet)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVBitSet)
+    union_body = KVBitSetRsp.KVBitSet()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return union_body.Changed()
+
+
+  async def test_bits(self, key:str, bits:typing.List[int], group:str = None) -> typing.List[bool]:
+    """Get bits of a bitmap. Bits beyond the bitmap, or of a key that doesn't exist, are False.
+
+    Returns a list of bool, in the same order as `bits`.
+    """
+    raise_if(len(key) == 0, 'key is empty')
+    raise_if(len(bits) == 0, 'bits is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=256)
+
+    keyOffset = fb.CreateString(key)
+    bitsOffset = self._create_bits(fb, bits)
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVBitTest.Start(fb)
+    KVBitTest.AddKey(fb, keyOffset)
+    KVBitTest.AddBits(fb, bitsOffset)
+    if group:
+      KVBitTest.AddGroup(fb, groupOffset)
+    body = KVBitTest.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVBitTest)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVBitTest)
+    union_body = KVBitTestRsp.KVBitTest()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return [union_body.Bits(i) for i in range(union_body.BitsLength())]
+
+
+  async def count_bits(self, keys:typing.List[str], *, start:int = 0, stop:int = 0, group:str = None) -> dict:
+    """Count the bits set in bitmaps, in the bit range [`start`, `stop`). If `stop` is 0, counts to the end of each bitmap.
+
+    Returns key:count. Keys which don't exist or aren't a bitmap are not in the dict.
+    """
+    raise_if(len(keys) == 0, 'keys is empty')
+    raise_if(start < 0 or stop < 0, 'start and stop cannot be negative')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=256)
+
+    keysOffset = self._create_key_strings(fb, keys)
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVBitCount.Start(fb)
+    KVBitCount.AddKeys(fb, keysOffset)
+    KVBitCount.AddStart(fb, start)
+    KVBitCount.AddStop(fb, stop)
+    if group:
+      KVBitCount.AddGroup(fb, groupOffset)
+    body = KVBitCount.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVBitCount)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVBitCount)
+    union_body = KVBitCountRsp.KVBitCount()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return flatbuffers.flexbuffers.Loads(union_body.KvAsNumpy().tobytes())
+
+
+  async def bit_op(self, op:str, dest:str, keys:typing.List[str], group:str = None) -> int:
+    """Combine bitmaps on the server, storing the result in `dest`, which is replaced.
+
+    @param: op One of: 'and', 'or', 'xor', 'and_not' (the first bitmap with the bits of the others cleared)
+    @param: keys A key which doesn't exist is an empty bitmap. `dest` can be one of the keys.
+
+    The result is the size of the largest bitmap. Returns the number of bits set in the result.
+    """
+    ops = {'and': BitOp.BitOp.And,
+           'or': BitOp.BitOp.Or,
+           'xor': BitOp.BitOp.Xor,
+           'and_not': BitOp.BitOp.AndNot}
+
+    raise_if(op not in ops, 'op is invalid')
+    raise_if(len(dest) == 0, 'dest is empty')
+    raise_if(len(keys) == 0, 'keys is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=256)
+
+    destOffset = fb.CreateString(dest)
+    keysOffset = self._create_key_strings(fb, keys)
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVBitOp.Start(fb)
+    KVBitOp.AddOp(fb, ops[op])
+    KVBitOp.AddDest(fb, destOffset)
+    KVBitOp.AddKeys(fb, keysOffset)
+    if group:
+      KVBitOp.AddGroup(fb, groupOffset)
+    body = KVBitOp.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVBitOp)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVBitOp)
+    union_body = KVBitOpRsp.KVBitOp()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return union_body.Count()
+
+
+  async def hll_add(self, key:str, items:typing.List[str|int], group:str = None) -> bool:
+    """Add items to a HyperLogLog, which estimates the number of unique items without storing them.
+
+    The HyperLogLog is created if `key` doesn't exist. It is a blob value, which is at most ~4KB. An int item is added as its str.
+
+    Returns True if the estimate may have changed.
+    """
+    raise_if(len(key) == 0, 'key is empty')
+    raise_if(len(items) == 0, 'items is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=1024)
+
+    keyOffset = fb.CreateString(key)
+    itemsOffset = self._create_key_strings(fb, [str(item) for item in items])
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVHllAdd.Start(fb)
+    KVHllAdd.AddKey(fb, keyOffset)
+    KVHllAdd.AddItems(fb, itemsOffset)
+    if group:
+      KVHllAdd.AddGroup(fb, groupOffset)
+    body = KVHllAdd.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVHllAdd)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVHllAdd)
+    union_body = KVHllAddRsp.KVHllAdd()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return union_body.Updated()
+
+
+  async def hll_count(self, keys:typing.List[str], group:str = None) -> int:
+    """Estimated number of unique items in the union of HyperLogLogs. A key which doesn't exist is empty.
+
+    The standard error is ~1.6%.
+    """
+    raise_if(len(keys) == 0, 'keys is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=256)
+
+    keysOffset = self._create_key_strings(fb, keys)
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVHllCount.Start(fb)
+    KVHllCount.AddKeys(fb, keysOffset)
+    if group:
+      KVHllCount.AddGroup(fb, groupOffset)
+    body = KVHllCount.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVHllCount)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVHllCount)
+    union_body = KVHllCountRsp.KVHllCount()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return union_body.Count()
+
+
+  async def hll_merge(self, dest:str, keys:typing.List[str], group:str = None) -> int:
+    """Store the union of HyperLogLogs in `dest`, which is replaced. `dest` can be one of the keys.
+
+    Returns the estimated number of unique items in the result.
+    """
+    raise_if(len(dest) == 0, 'dest is empty')
+    raise_if(len(keys) == 0, 'keys is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=256)
+
+    destOffset = fb.CreateString(dest)
+    keysOffset = self._create_key_strings(fb, keys)
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVHllMerge.Start(fb)
+    KVHllMerge.AddDest(fb, destOffset)
+    KVHllMerge.AddKeys(fb, keysOffset)
+    if group:
+      KVHllMerge.AddGroup(fb, groupOffset)
+    body = KVHllMerge.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVHllMerge)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVHllMerge)
+    union_body = KVHllMergeRsp.KVHllMerge()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return union_body.Count()
+
+
+  async def nearest(self, query:typing.List[float], k:int, *, metric:str = 'cosine', group:str = None, threads:int = 1) -> typing.List[typing.Tuple[str, float]]:
+    """Find the `k` float list values most similar to `query`, comparing on the server rather than getting the values.
+
+    @param: metric One of: 'dot', 'cosine', 'l2' (Euclidean distance)
+    @param: threads A large group is split across up to this many threads on the server
+
+    Only values with the same number of elements as `query` are compared.
+
+    Returns a list of (key, score), most similar first. For 'l2' the score is the distance, otherwise the similarity.
+    """
+    metrics = {'dot': Metric.Metric.Dot,
+               'cosine': Metric.Metric.Cosine,
+               'l2': Metric.Metric.L2}
+
+    raise_if(metric not in metrics, 'metric is invalid')
+    raise_if(len(query) == 0, 'query is empty')
+    raise_if(k <= 0, 'k must be greater than 0')
+    raise_if(threads < 1 or threads > 255, 'threads must be 1 to 255')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=1024)
+
+    fb.StartVector(4, len(query), 4)
+    for v in reversed(query):
+      fb.PrependFloat32(v)
+    queryOffset = fb.EndVector()
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVNearest.Start(fb)
+    KVNearest.AddQuery(fb, queryOffset)
+    KVNearest.AddMetric(fb, metrics[metric])
+    KVNearest.AddK(fb, k)
+    KVNearest.AddThreads(fb, threads)
+    if group:
+      KVNearest.AddGroup(fb, groupOffset)
+    body = KVNearest.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVNearest)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVNearest)
+    union_body = KVNearestRsp.KVNearest()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return [(union_body.Keys(i).decode(), union_body.Scores(i)) for i in range(union_body.KeysLength())]
+
+
+  async def get_versions(self, keys:typing.List[str], group:str = None) -> typing.Tuple[dict, dict]:
+    """Get keys and their versions, for use with `cas()`.
+
+    Returns a tuple of two dicts: key:value and key:version.
+    """
+    raise_if(len(keys) == 0, 'keys is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+    return await self._do_get_versions(keys, group)
+
+
+  async def get_if_changed(self, versions:dict, group:str = None) -> typing.Tuple[dict, dict] | None:
+    """Get keys only if at least one has changed, i.e. its version is not that in `versions`.
+    
+    @param: versions key:version, usually from the previous call or `get_versions()`. Version 0 is a key that doesn't exist.
+
+    Returns None if none have changed, otherwise as `get_versions()`.
+    """
+    raise_if(len(versions) == 0, 'versions is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+    return await self._do_get_versions(list(versions.keys()), group, ifChanged=versions)
+
+
+  async def cas(self, kv:dict, versions:dict, group:str = None) -> dict:
+    """Compare-and-swap: set each key in `kv` only if its current version
+    equals the version in `versions`. A version of 0 means the key must not exist.
+
+    Returns key:bool, True if the key was set. A key's version is incremented each time it is changed.
+    """
+    raise_if(len(kv) == 0, 'keys empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=1024)
+
+    kvOffset = fb.CreateByteVector(createKvMap(kv))
+    versionsOffset = fb.CreateByteVector(createKvMap(versions))
+
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVCas.Start(fb)
+    KVCas.AddKv(fb, kvOffset)
+    KVCas.AddVersions(fb, versionsOffset)
+    if group:
+      KVCas.AddGroup(fb, groupOffset)
+    body = KVCas.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVCas)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVCas)
+    union_body = KVCasRsp.KVCas()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return flatbuffers.flexbuffers.Loads(union_body.KvAsNumpy().tobytes())
+
+
+  async def append(self, kv:dict, group:str = None) -> dict:
+    """Append to string, blob (bytes) and list values, changing the value in place.
+
+    A key that does not exist is set. Returns key:new size, where size is bytes for
+    a string or blob, otherwise the number of elements. A key is not returned if the
+    value can't be appended, such as a str to a list.
+    """
+    return await self._do_write(kv, RequestBody.RequestBody.KVAppend, group=group)
+
+
+  async def write_at(self, kv:dict, offsets:dict, group:str = None) -> dict:
+    """Overwrite part of string, blob (bytes) and list values, from the offset in `offsets`.
+
+    The offset is bytes for a string or blob, otherwise elements. The value grows if required,
+    but the offset can't be beyond the end of the existing value. A key that does not exist is set 
+    if its offset is 0. Returns the same as `append()`.
+    """
+    raise_if(len(offsets) == 0, 'offsets empty')
+    raise_if(not all(isinstance(o, int) and o >= 0 for o in offsets.values()), 'offsets must be an int >= 0')
+    return await self._do_write(kv, RequestBody.RequestBody.KVWriteAt, offsets=offsets, group=group)
+
+
+  async def scan(self, cursor:int = 0, *, count:int = 100, match:str = None, keys_only:bool = False, group:str = None) -> typing.Tuple[int, dict | list]:
+    """Incrementally iterate keys. Start with `cursor` 0, then call with the returned
+    cursor until it is 0.
+
+    @param: count The number of keys examined, so fewer may be returned.
+    @param: match Glob pattern, with * and ? wildcards.
+    @param: keys_only Return a list of keys rather than a dict of key:value.
+    """
+    raise_if(cursor < 0, 'cursor must be >= 0')
+    raise_if(count < 1, 'count must be > 0')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=256)
+
+    if group:
+      groupOffset = fb.CreateString(group)
+    if match:
+      matchOffset = fb.CreateString(match)
+
+    KVScan.Start(fb)
+    KVScan.AddCursor(fb, cursor)
+    KVScan.AddCount(fb, count)
+    KVScan.AddKeysOnly(fb, keys_only)
+    if group:
+      KVScan.AddGroup(fb, groupOffset)
+    if match:
+      KVScan.AddMatch(fb, matchOffset)
+    body = KVScan.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVScan)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVScan)
+    union_body = KVScanRsp.KVScan()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+
+    result = self._decode(flatbuffers.flexbuffers.Loads(union_body.KvAsNumpy().tobytes()), union_body.Encoded())
+    return (union_body.Cursor(), result)
+
+
+  async def set_chunked(self, key:str, data:bytes, *, group:str = None, chunk_size:int = 15*1024) -> None:
+    """Set a blob in chunks, for blobs larger than the server's max payload. The key is
+    only set when all chunks are received.
+
+    @param: chunk_size Bytes per message, which must be less than the server's max payload.
+    """
+    raise_if(len(key) == 0, 'key is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+    raise_if(chunk_size < 1, 'chunk_size must be > 0')
+
+    id = await self._do_chunk_begin(key, len(data), group)
+
+    try:
+      for offset in range(0, len(data), chunk_size):
+        fb = flatbuffers.Builder(initialSize=chunk_size+128)
+        dataOffset = fb.CreateByteVector(bytes(data[offset:offset+chunk_size]))
+
+        KVChunkAppend.Start(fb)
+        KVChunkAppend.AddId(fb, id)
+        KVChunkAppend.AddData(fb, dataOffset)
+        body = KVChunkAppend.End(fb)
+
+        self._complete_request(fb, body, RequestBody.RequestBody.KVChunkAppend)
+        await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVChunkAppend)
+
+      await self._do_chunk_commit(id, abort=False)
+    except:
+      try:
+        await self._do_chunk_commit(id, abort=True)
+      except ResponseError:
+        pass
+      raise
+
+
+  async def get_chunks(self, key:str, *, group:str = None, chunk_size:int = 512*1024) -> typing.AsyncIterator[bytes]:
+    """Get a blob in chunks, yielding each chunk as it is received. The next chunk is
+    only requested when the previous has been consumed.
+    """
+    raise_if(len(key) == 0, 'key is empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+    raise_if(chunk_size < 1, 'chunk_size must be > 0')
+
+    offset = 0
+    while True:
+      fb = flatbuffers.Builder(initialSize=256)
+      keyOffset = fb.CreateString(key)
+      if group:
+        groupOffset = fb.CreateString(group)
+
+      KVChunkGet.Start(fb)
+      KVChunkGet.AddKey(fb, keyOffset)
+      KVChunkGet.AddOffset(fb, offset)
+      KVChunkGet.AddSize(fb, chunk_size)
+      if group:
+        KVChunkGet.AddGroup(fb, groupOffset)
+      body = KVChunkGet.End(fb)
+
+      self._complete_request(fb, body, RequestBody.RequestBody.KVChunkGet)
+
+      rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVChunkGet)
+      union_body = KVChunkGetRsp.KVChunkGet()
+      union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+
+      data = union_body.DataAsNumpy()
+      chunk = b'' if isinstance(data, int) else data.tobytes()
+      offset += len(chunk)
+
+      if len(chunk):
+        yield chunk
+      
+      if len(chunk) == 0 or offset >= union_body.Size():
+        break
+
+
+  async def get_chunked(self, key:str, *, group:str = None, chunk_size:int = 512*1024) -> bytes:
+    """Get a blob in chunks, for blobs larger than the client's max message size."""
+    result = bytearray()
+    async for chunk in self.get_chunks(key, group=group, chunk_size=chunk_size):
+      result += chunk
+    return bytes(result)
+
+
   ## Helpers ##
+  def _create_fields_request (self, fb: flatbuffers.Builder, key: str, fields: dict, group: str) -> typing.Tuple[int, int, int]:
+    raise_if(not all(isinstance(v, (bool, int, float, str)) for v in fields.values()), 'field values must be int, float, bool or str')
+
+    fieldsOffset = fb.CreateByteVector(createKvMap(fields))
+    keyOffset = fb.CreateString(key)
+    groupOffset = fb.CreateString(group) if group else None
+    return (fieldsOffset, keyOffset, groupOffset)
+
+
+  def _create_bits (self, fb: flatbuffers.Builder, bits: typing.List[int]) -> int:
+    raise_if(any(b < 0 for b in bits), 'bits cannot be negative')
+
+    fb.StartVector(8, len(bits), 8)
+    for b in reversed(bits):
+      fb.PrependUint64(b)
+    return fb.EndVector()
+
+
   def _create_key_strings (self, fb: flatbuffers.Builder, strings: list) -> int:
     keysOffsets = []
     for key in strings:
@@ -177,6 +1167,15 @@ class KV:
     return fb.EndVector()
 
 
+  def _decode(self, kv: dict | list, encoded: bool) -> dict | list:
+    # in an encoded group, string, blob and list values are returned as a blob containing the value's flexbuffer
+    if encoded and isinstance(kv, dict):
+      for key, value in kv.items():
+        if isinstance(value, (bytes, bytearray)):
+          kv[key] = flatbuffers.flexbuffers.Loads(value)
+    return kv
+
+
   def _complete_request(self, fb: flatbuffers.Builder, body: int, bodyType: RequestBody.RequestBody):
     try:
       Request.RequestStart(fb)
@@ -191,7 +1190,7 @@ class KV:
       fb.Clear()
 
 
-  async def _do_get(self, *, key:str=None, keys:typing.List[str] = None, group:str=None):
+  async def _do_get(self, *, key:str=None, keys:typing.List[str] = None, group:str=None, slices:dict=None, sizeOnly:bool=False):
     raise_if(key is None and keys is None and group is None, 'invalid _do_get() call')
 
     isGetAll = key is None and keys is None
@@ -210,12 +1209,19 @@ class KV:
       if group:
         groupOffset = fb.CreateString(group)
 
+      if slices:
+        slicesOffset = fb.CreateByteVector(createKvMap(slices))
+
       KVGet.Start(fb)
       
       if not isGetAll:
         KVGet.AddKeys(fb, keysOff)
       if group:
         KVGet.AddGroup(fb, groupOffset)
+      if slices:
+        KVGet.AddSlices(fb, slicesOffset)
+      if sizeOnly:
+        KVGet.AddSizeOnly(fb, True)
       
       body = KVGet.End(fb)
 
@@ -226,7 +1232,7 @@ class KV:
       union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
 
       # this is how we get a flexbuffer from a flatbuffer
-      result = flatbuffers.flexbuffers.Loads(union_body.KvAsNumpy().tobytes())
+      result = self._decode(flatbuffers.flexbuffers.Loads(union_body.KvAsNumpy().tobytes()), union_body.Encoded())
       if isSingleKey:
         return result[key] if key in result else None  # single key, so return value
       else:
@@ -236,6 +1242,38 @@ class KV:
       logger.error(e)
 
   
+  async def _do_get_versions(self, keys:typing.List[str], group:str = None, ifChanged:dict = None) -> typing.Tuple[dict, dict] | None:
+    fb = flatbuffers.Builder(initialSize=1024)
+    keysOff = self._create_key_strings(fb, keys)
+
+    if group:
+      groupOffset = fb.CreateString(group)
+    if ifChanged:
+      ifChangedOffset = fb.CreateByteVector(createKvMap(ifChanged))
+
+    KVGet.Start(fb)
+    KVGet.AddKeys(fb, keysOff)
+    KVGet.AddVersions(fb, True)
+    if group:
+      KVGet.AddGroup(fb, groupOffset)
+    if ifChanged:
+      KVGet.AddIfChanged(fb, ifChangedOffset)
+    body = KVGet.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVGet)
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVGet, allowNotModified=True)
+
+    if rsp.Status() == Status.Status.NotModified:
+      return None
+
+    union_body = KVGetRsp.KVGet()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+
+    kv = self._decode(flatbuffers.flexbuffers.Loads(union_body.KvAsNumpy().tobytes()), union_body.Encoded())
+    versions = flatbuffers.flexbuffers.Loads(union_body.VersionsAsNumpy().tobytes())
+    return (kv, versions)
+
+
   async def _do_set_add(self, kv: dict, requestType: RequestBody.RequestBody, group: str = None) -> None:
     """KVSet, KVAdd and KVClearSet all use a flexbuffer map, so they all 
     use this function to populate the map from `kv`"""
@@ -296,3 +1334,110 @@ class KV:
 
     self._complete_request(fb, body, RequestBody.RequestBody.KVClear)
     await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVClear)
+
+
+
+  async def _do_chunk_begin(self, key:str, size:int, group:str = None) -> int:
+    fb = flatbuffers.Builder(initialSize=256)
+    keyOffset = fb.CreateString(key)
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    KVChunkBegin.Start(fb)
+    KVChunkBegin.AddKey(fb, keyOffset)
+    KVChunkBegin.AddSize(fb, size)
+    if group:
+      KVChunkBegin.AddGroup(fb, groupOffset)
+    body = KVChunkBegin.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVChunkBegin)
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVChunkBegin)
+    union_body = KVChunkBeginRsp.KVChunkBegin()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return union_body.Id()
+
+
+  async def _do_chunk_commit(self, id:int, *, abort:bool) -> None:
+    fb = flatbuffers.Builder(initialSize=64)
+
+    KVChunkCommit.Start(fb)
+    KVChunkCommit.AddId(fb, id)
+    KVChunkCommit.AddAbort(fb, abort)
+    body = KVChunkCommit.End(fb)
+
+    self._complete_request(fb, body, RequestBody.RequestBody.KVChunkCommit)
+    await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.KVChunkCommit)
+
+
+  async def _do_add_numeric(self, kv:dict, requestType: RequestBody.RequestBody, group:str = None) -> dict:
+    """KVIncr, KVDecr and KVAddFloat use a flexbuffer map of key:amount, and return the new values."""
+
+    raise_if(len(kv) == 0, 'keys empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+
+    fb = flatbuffers.Builder(initialSize=1024)
+
+    kvOffset = fb.CreateByteVector(createKvMap(kv))
+
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    if requestType is RequestBody.RequestBody.KVIncr:
+      req, rspBody = KVIncr, KVIncrRsp.KVIncr()
+    elif requestType is RequestBody.RequestBody.KVDecr:
+      req, rspBody = KVDecr, KVDecrRsp.KVDecr()
+    elif requestType is RequestBody.RequestBody.KVAddFloat:
+      req, rspBody = KVAddFloat, KVAddFloatRsp.KVAddFloat()
+    else:
+      raise ValueError("RequestBody not permitted")
+
+    req.Start(fb)
+    req.AddKv(fb, kvOffset)
+    if group:
+      req.AddGroup(fb, groupOffset)
+    body = req.End(fb)
+
+    self._complete_request(fb, body, requestType)
+
+    rsp = await self.client.sendCmd(fb.Output(), requestType)
+    rspBody.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return flatbuffers.flexbuffers.Loads(rspBody.KvAsNumpy().tobytes())
+
+
+  async def _do_write(self, kv:dict, requestType: RequestBody.RequestBody, *, offsets:dict = None, group:str = None) -> dict:
+    raise_if(len(kv) == 0, 'keys empty')
+    raise_if(group is not None and len(group) == 0, 'group name cannot be empty')
+    raise_if(not all(isinstance(v, (str, bytes, list, array.array)) for v in kv.values()), 'values must be str, bytes or list')
+
+    fb = flatbuffers.Builder(initialSize=1024)
+
+    kvOffset = fb.CreateByteVector(createKvMap(kv))
+
+    if offsets:
+      offsetsOffset = fb.CreateByteVector(createKvMap(offsets))
+
+    if group:
+      groupOffset = fb.CreateString(group)
+
+    if requestType is RequestBody.RequestBody.KVAppend:
+      KVAppend.Start(fb)
+      KVAppend.AddKv(fb, kvOffset)
+      if group:
+        KVAppend.AddGroup(fb, groupOffset)
+      body = KVAppend.End(fb)
+      rspBody = KVAppendRsp.KVAppend()
+    else:
+      KVWriteAt.Start(fb)
+      KVWriteAt.AddKv(fb, kvOffset)
+      KVWriteAt.AddOffsets(fb, offsetsOffset)
+      if group:
+        KVWriteAt.AddGroup(fb, groupOffset)
+      body = KVWriteAt.End(fb)
+      rspBody = KVWriteAtRsp.KVWriteAt()
+
+    self._complete_request(fb, body, requestType)
+
+    rsp = await self.client.sendCmd(fb.Output(), requestType)
+    rspBody.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return flatbuffers.flexbuffers.Loads(rspBody.KvAsNumpy().tobytes())
\ No newline at end of file
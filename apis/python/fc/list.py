@@ -10,7 +10,7 @@ from fc.fbs.fc.request import (Request, RequestBody, Range, Base,
                                ListCreate, ListAdd, ListDelete, ListGetRange, ListRemove,
                                ListRemoveIf, ListIntersect, ListSet, ListAppend, ListInfo)
 from fc.fbs.fc.request import (IntValue, StringValue, FloatValue, Value)
-from fc.fbs.fc.response import (ResponseBody,
+from fc.fbs.fc.response import (ResponseBody, Status,
                                 ListGetRange as ListGetRangeRsp,
                                 ListIntersect as ListIntersectRsp,
                                 ListAdd as ListAddRsp,
@@ -117,6 +117,18 @@ class List(ABC):
     return await self._do_get_range(name, Base.Base.Tail, start, stop)
 
 
+  async def get_range_if_changed(self, name: str, version:int, *, start:int, stop: int = None) -> typing.Tuple[list, int] | None:
+    """Get a range only if the list has changed, i.e. its version is not `version`.
+
+    @param: version From the previous call. 0 always gets the range.
+
+    Returns None if the list hasn't changed, otherwise a tuple of the range and the list's version.
+    """
+    raise_if(version < 0, 'version must be >= 0')
+    raise_if_not(self._is_range_valid(start, stop), 'range invalid')
+    return await self._do_get_range(name, Base.Base.Head, start, stop, ifChanged=version)
+
+
   async def remove(self, name:str, *, start: int = 0, stop: int = None) -> None:
     raise_if_not(self._is_range_valid(start, stop), 'range invalid')
     raise_if(len(name) == 0, 'list name empty')
@@ -198,6 +210,29 @@ class List(ABC):
   
 
   async def info (self, name:str) -> typing.Tuple[int,str, bool]:
+    union_body = await self._do_info(name)
+
+    list_type = ''
+    match union_body.Type():
+      case ListType.ListType.Float:
+        list_type = 'float'
+      case ListType.ListType.String:
+        list_type = 'str'
+      case ListType.ListType.Int | ListType.ListType.UInt:  # UInt not possible, but here for completeness
+        list_type = 'int'
+
+    return (union_body.Size(), list_type, union_body.Sorted())
+
+
+  async def memory (self, name:str) -> int:
+    """Estimated bytes used by the list's nodes, including the allocations of string items."""
+    union_body = await self._do_info(name)
+    return union_body.Memory()
+
+
+
+  ### helpers
+  async def _do_info(self, name:str) -> ListInfoRsp.ListInfo:
     raise_if(len(name) == 0, 'name is empty')
     
     fb = flatbuffers.Builder(256)
@@ -212,22 +247,10 @@ class List(ABC):
 
     union_body = ListInfoRsp.ListInfo()
     union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
-
-    list_type = ''
-    match union_body.Type():
-      case ListType.ListType.Float:
-        list_type = 'float'
-      case ListType.ListType.String:
-        list_type = 'str'
-      case ListType.ListType.Int | ListType.ListType.UInt:  # UInt not possible, but here for completeness
-        list_type = 'int'
-
-    return (union_body.Size(), list_type, union_body.Sorted())
+    return union_body
 
 
-
-  ### helpers
-  async def _do_get_range(self, name: str, base: Base.Base, start:int, stop: int = None) -> list:    
+  async def _do_get_range(self, name: str, base: Base.Base, start:int, stop: int = None, ifChanged: int = None) -> list | typing.Tuple[list, int] | None:
     try:
       raise_if(len(name) == 0, 'name is empty')
 
@@ -245,15 +268,20 @@ class List(ABC):
       ListGetRange.AddName(fb, nameOffset)
       ListGetRange.AddRange(fb, rangeOffset)
       ListGetRange.AddBase(fb, base)
+      if ifChanged:
+        ListGetRange.AddIfChanged(fb, ifChanged)
       body = ListGetRange.End(fb)
 
       self._complete_request(fb, body, RequestBody.RequestBody.ListGetRange)
-      rsp = await self.client.sendCmd(fb.Output(), ResponseBody.ResponseBody.ListGetRange)
+      rsp = await self.client.sendCmd(fb.Output(), ResponseBody.ResponseBody.ListGetRange, allowNotModified=ifChanged is not None)
+
+      if rsp.Status() == Status.Status.NotModified:
+        return None
 
       union_body = ListGetRangeRsp.ListGetRange()
       union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
       result = flatbuffers.flexbuffers.Loads(union_body.ItemsAsNumpy().tobytes())
-      return result
+      return result if ifChanged is None else (result, union_body.Version())
     except Exception as e:
       logger.error(e)
       print(e)
@@ -0,0 +1,33 @@
+import flatbuffers
+import flatbuffers.flexbuffers
+from fc.client import Client
+from fc.fbs.fc.common import Ident
+from fc.fbs.fc.request import Request, RequestBody, ServerInfo
+from fc.fbs.fc.response import ServerInfo as ServerInfoRsp
+
+
+class Server:
+  "Server API. If a response returns a fail, a ResponseError is raised."
+
+  def __init__(self, client: Client):
+    self.client = client
+
+
+  async def info(self) -> dict:
+    """Returns server metrics in a dict, keyed by metric name."""
+    fb = flatbuffers.Builder(initialSize=64)
+
+    ServerInfo.Start(fb)
+    body = ServerInfo.End(fb)
+
+    Request.RequestStart(fb)
+    Request.AddIdent(fb, Ident.Ident.Server)
+    Request.AddBodyType(fb, RequestBody.RequestBody.ServerInfo)
+    Request.AddBody(fb, body)
+    fb.Finish(Request.RequestEnd(fb))
+
+    rsp = await self.client.sendCmd(fb.Output(), RequestBody.RequestBody.ServerInfo)
+
+    union_body = ServerInfoRsp.ServerInfo()
+    union_body.Init(rsp.Body().Bytes, rsp.Body().Pos)
+    return flatbuffers.flexbuffers.Loads(union_body.MetricsAsNumpy().tobytes())
@@ -2,6 +2,7 @@ from unittest import IsolatedAsyncioTestCase
 from fc.client import fcache
 from fc.kv import KV
 from fc.list import UnsortedList, SortedList
+from fc.server import Server
 
 
 class FcTest(IsolatedAsyncioTestCase):
@@ -35,4 +36,12 @@ class SortedListTest(FcTest):
     self.list = SortedList(self.client)
     await self.list.delete_all()
 
-    
\ No newline at end of file
+    
+
+
+class ServerTest(FcTest):
+  async def asyncSetUp(self):
+    await super().asyncSetUp()
+    self.server = Server(self.client)
+    self.kv = KV(self.client)
+    await self.kv.clear()
@@ -1,6 +1,9 @@
+import asyncio
 import unittest
 from base import KvTest
+from fc.client import fcache
 from fc.common import ResponseError
+from fc.kv import KV
 
 
 class KV(KvTest):
@@ -153,11 +156,410 @@ class KV(KvTest):
     self.assertIsNone(await self.kv.get(key='___'))
 
 
+  async def test_incr_decr(self):
+    await self.kv.set({'count':10, 'name':'Bob'})
+
+    self.assertDictEqual(await self.kv.incr({'count':5}), {'count':15})
+    self.assertDictEqual(await self.kv.decr({'count':20}), {'count':-5})
+    
+    # missing key created, non-integer value unchanged and absent
+    self.assertDictEqual(await self.kv.incr({'count':5, 'new':3, 'name':1}), {'count':0, 'new':3})
+    self.assertDictEqual(await self.kv.decr({'other':3}), {'other':-3})
+    self.assertEqual(await self.kv.get_key('name'), 'Bob')
+    self.assertEqual(await self.kv.get_key('new'), 3)
+
+
+  async def test_add_float(self):
+    await self.kv.set({'temp':20.5, 'count':1})
+
+    self.assertDictEqual(await self.kv.add_float({'temp':1.25}), {'temp':21.75})
+    self.assertDictEqual(await self.kv.add_float({'temp':-0.75, 'new':2, 'count':1.0}), {'temp':21.0, 'new':2.0})
+    self.assertEqual(await self.kv.get_key('count'), 1)
+
+
+  async def test_cas(self):
+    await self.kv.set({'a':1, 'b':'x'})
+
+    kv, versions = await self.kv.get_versions(['a', 'b', 'c'])
+    self.assertDictEqual(kv, {'a':1, 'b':'x'})
+    self.assertNotIn('c', versions)
+
+    # 'b' version is stale, 'c' doesn't exist so version 0 creates it
+    result = await self.kv.cas({'a':2, 'b':'y', 'c':3}, {'a':versions['a'], 'b':versions['b']+1, 'c':0})
+    self.assertDictEqual(result, {'a':True, 'b':False, 'c':True})
+    self.assertDictEqual(await self.kv.get_keys(['a','b','c']), {'a':2, 'b':'x', 'c':3})
+
+    # version changed by the set, so retry with the old version fails
+    _, newVersions = await self.kv.get_versions(['a'])
+    self.assertGreater(newVersions['a'], versions['a'])
+    self.assertDictEqual(await self.kv.cas({'a':5}, {'a':versions['a']}), {'a':False})
+    # missing expected version fails
+    self.assertDictEqual(await self.kv.cas({'a':5}, {}), {'a':False})
+    self.assertEqual(await self.kv.get_key('a'), 2)
+
+
+  async def test_get_if_changed(self):
+    await self.kv.set({'a':1, 'b':'x'})
+
+    kv, versions = await self.kv.get_versions(['a', 'b'])
+    self.assertIsNone(await self.kv.get_if_changed(versions))
+    # version 0 is a key that doesn't exist
+    self.assertIsNone(await self.kv.get_if_changed({'missing':0}))
+
+    await self.kv.set({'a':2})
+    kv, newVersions = await self.kv.get_if_changed(versions)
+    self.assertDictEqual(kv, {'a':2, 'b':'x'})
+    self.assertGreater(newVersions['a'], versions['a'])
+    self.assertEqual(newVersions['b'], versions['b'])
+    self.assertIsNone(await self.kv.get_if_changed(newVersions))
+
+    # key created
+    kv, _ = await self.kv.get_if_changed({'c':0})
+    self.assertDictEqual(kv, {})
+    await self.kv.set({'c':3})
+    kv, _ = await self.kv.get_if_changed({'c':0})
+    self.assertDictEqual(kv, {'c':3})
+
+
+  async def test_version_not_reused(self):
+    await self.kv.set({'a':1})
+    _, versions = await self.kv.get_versions(['a'])
+
+    # removed then set again, the same value but a new version
+    await self.kv.remove(key='a')
+    await self.kv.set({'a':1})
+    kv, newVersions = await self.kv.get_if_changed(versions)
+    self.assertDictEqual(kv, {'a':1})
+    self.assertNotEqual(newVersions['a'], versions['a'])
+    self.assertDictEqual(await self.kv.cas({'a':2}, versions), {'a':False})
+
+    # replaced by clear_set
+    await self.kv.clear_set({'a':1})
+    self.assertIsNotNone(await self.kv.get_if_changed(newVersions))
+
+
+  async def test_append(self):
+    await self.kv.set({'s':'abc', 'b':bytes([1,2]), 'i':[1,2], 'strs':['a','b'], 'n':5})
+
+    result = await self.kv.append({'s':'de', 'b':bytes([3]), 'i':[3,4], 'strs':['c'], 'n':'x', 'new':'xyz'})
+    self.assertDictEqual(result, {'s':5, 'b':3, 'i':4, 'strs':3, 'new':3})
+
+    self.assertDictEqual(await self.kv.get_keys(['s','b','i','strs','n','new']),
+                         {'s':'abcde', 'b':bytes([1,2,3]), 'i':[1,2,3,4], 'strs':['a','b','c'], 'n':5, 'new':'xyz'})
+
+    # incompatible type
+    self.assertDictEqual(await self.kv.append({'i':['x']}), {})
+
+
+  async def test_write_at(self):
+    await self.kv.set({'s':'abcde', 'b':bytes([1,2,3]), 'i':[1,2,3], 'strs':['a','bb','c']})
+
+    result = await self.kv.write_at({'s':'XYZ', 'b':bytes([9,9]), 'i':[7], 'strs':['longer','d']},
+                                    {'s':3, 'b':1, 'i':0, 'strs':1})
+    self.assertDictEqual(result, {'s':6, 'b':3, 'i':3, 'strs':3})
+
+    self.assertDictEqual(await self.kv.get_keys(['s','b','i','strs']),
+                         {'s':'abcXYZ', 'b':bytes([1,9,9]), 'i':[7,2,3], 'strs':['a','longer','d']})
+
+    # offset beyond end, and missing key at non-zero offset
+    self.assertDictEqual(await self.kv.write_at({'s':'!', 'new':'x'}, {'s':7, 'new':1}), {})
+    self.assertDictEqual(await self.kv.write_at({'new':'x'}, {'new':0}), {'new':1})
+
+
+  async def test_get_slices(self):
+    await self.kv.set({'s':'abcdef', 'b':bytes([1,2,3,4]), 'i':[1,2,3,4,5], 'strs':['a','b','c','d'], 'n':5})
+
+    out = await self.kv.get_slices({'s':[1,3], 'b':[-2], 'i':[-3,-1], 'strs':[1], 'n':[0,1]})
+    self.assertDictEqual(out, {'s':'bc', 'b':bytes([3,4]), 'i':[3,4], 'strs':['b','c','d'], 'n':5})
+
+    # invalid range returns empty value
+    out = await self.kv.get_slices({'s':[10], 'i':[3,1]})
+    self.assertDictEqual(out, {'s':'', 'i':[]})
+
+
+  async def test_get_sizes(self):
+    await self.kv.set({'s':'abcdef', 'b':bytes([1,2,3,4]), 'i':[1,2,3,4,5], 'strs':['a','bb'], 'n':5})
+    self.assertDictEqual(await self.kv.get_sizes(['s','b','i','strs','n','none']), {'s':6, 'b':4, 'i':5, 'strs':2, 'n':1})
+
+    await self.kv.set({'s':'abc', 'i':[1]}, group='g')
+    self.assertDictEqual(await self.kv.get_sizes(group='g'), {'s':3, 'i':1})
+
+
+  async def test_aggregate(self):
+    ints = list(range(-50, 51))
+    floats = [1.5, -0.25, 2.5, 4.0]
+    await self.kv.set({'ints':ints, 'floats':floats, 'str':'abc', 'int':5}, group='g')
+
+    self.assertDictEqual(await self.kv.aggregate('sum', group='g'), {'ints':0, 'floats':7.75})
+    self.assertDictEqual(await self.kv.aggregate('min', ['ints', 'floats', 'str', 'int'], group='g'), {'ints':-50, 'floats':-0.25})
+    self.assertDictEqual(await self.kv.aggregate('max', ['ints', 'floats'], group='g'), {'ints':50, 'floats':4.0})
+    self.assertDictEqual(await self.kv.aggregate('mean', ['floats'], group='g'), {'floats':7.75/4})
+    self.assertDictEqual(await self.kv.aggregate('count_above', ['ints', 'floats'], group='g', threshold=2), {'ints':48, 'floats':2})
+    self.assertDictEqual(await self.kv.aggregate('dot', group='g', operand=[2, 2, 2, 2]), {'floats':15.5})
+    self.assertDictEqual(await self.kv.aggregate('sum', ['ints'], group='none'), {})
+
+    # sums beyond 64 bits, including in the lanes and the remainder
+    big = [2**63 - 1] * 9 + [1]
+    await self.kv.set({'big':big, 'small':[-2**63] * 9, 'limits':[2**63 - 1, -2**63, 1]}, group='g')
+    self.assertDictEqual(await self.kv.aggregate('sum', ['big', 'small', 'limits'], group='g'), {'big':float(sum(big)), 'small':float(-2**63 * 9), 'limits':0})
+    self.assertDictEqual(await self.kv.aggregate('mean', ['big'], group='g'), {'big':sum(big) / len(big)})
+
+    with self.assertRaises(ValueError):
+      await self.kv.aggregate('median', ['ints'])
+
+
+  async def test_info(self):
+    await self.kv.set({'i':-1, 'f':1.5, 'b':True, 's':'abc', 'blob':bytes([1,2,3,4]), 'il':[1,2,3], 'sl':['a','bc']})
+    await self.kv.set({'s':'abcd'})
+
+    info = await self.kv.info(['i', 'f', 'b', 's', 'blob', 'il', 'sl', 'missing'])
+    self.assertNotIn('missing', info)
+    _, versions = await self.kv.get_versions(['i', 's'])
+    self.assertDictEqual(info['i'], {'type':'int', 'size':1, 'bytes':8, 'version':versions['i']})
+    self.assertEqual(info['f']['type'], 'float')
+    self.assertEqual(info['b']['type'], 'bool')
+    self.assertEqual(info['s']['type'], 'str')
+    self.assertEqual(info['s']['size'], 4)
+    self.assertEqual(info['s']['version'], versions['s'])
+    self.assertGreater(info['s']['version'], info['i']['version'])
+    self.assertEqual(info['blob']['type'], 'blob')
+    self.assertEqual(info['blob']['size'], 4)
+    self.assertEqual(info['il']['type'], 'int_list')
+    self.assertEqual(info['il']['size'], 3)
+    self.assertEqual(info['il']['bytes'], 24)
+    self.assertEqual(info['sl']['type'], 'str_list')
+    self.assertEqual(info['sl']['size'], 2)
+
+    await self.kv.set({'x':1, 'y':'y'}, group='g')
+    info = await self.kv.info(group='g')
+    self.assertListEqual(sorted(info.keys()), ['x', 'y'])
+
+
+  async def test_fields(self):
+    # a dict value is a hash
+    await self.kv.set({'user':{'name':'alice', 'age':30, 'score':1.5, 'active':True}})
+    self.assertDictEqual(await self.kv.get_key('user'), {'name':'alice', 'age':30, 'score':1.5, 'active':True})
+    self.assertEqual((await self.kv.info(['user']))['user']['type'], 'hash')
+
+    await self.kv.set_fields('user', {'name':'bob', 'city':'paris'})
+    self.assertDictEqual(await self.kv.get_fields('user', ['name', 'city', 'missing']), {'name':'bob', 'city':'paris'})
+    self.assertDictEqual(await self.kv.get_fields('user'), {'name':'bob', 'age':30, 'score':1.5, 'active':True, 'city':'paris'})
+
+    self.assertDictEqual(await self.kv.incr_fields('user', {'age':2, 'score':0.5, 'visits':1}), {'age':32, 'score':2.0, 'visits':1})
+    self.assertEqual((await self.kv.get_fields('user', ['age']))['age'], 32)
+
+    # fails without changing the hash
+    with self.assertRaises(ResponseError):
+      await self.kv.incr_fields('user', {'age':1, 'name':1})
+    self.assertEqual((await self.kv.get_fields('user', ['age']))['age'], 32)
+
+    # created if the key doesn't exist, and in a group
+    await self.kv.set_fields('new', {'a':1}, group='g')
+    self.assertDictEqual(await self.kv.get_keys(['new'], group='g'), {'new':{'a':1}})
+
+    # not a hash, or doesn't exist
+    await self.kv.set({'s':'abc'})
+    with self.assertRaises(ResponseError):
+      await self.kv.set_fields('s', {'a':1})
+    with self.assertRaises(ResponseError):
+      await self.kv.get_fields('s')
+    with self.assertRaises(ResponseError):
+      await self.kv.get_fields('missing')
+
+
+  async def test_bitmap(self):
+    # created, then extended to include the highest bit
+    self.assertEqual(await self.kv.set_bits('a', [0, 3, 9]), 3)
+    self.assertEqual(await self.kv.get_key('a'), bytes([0b1001, 0b10]))
+    self.assertEqual(await self.kv.set_bits('a', [3, 100]), 1)
+    self.assertEqual(await self.kv.get_sizes(['a']), {'a':13})
+    self.assertListEqual(await self.kv.test_bits('a', [0, 1, 100, 5000]), [True, False, True, False])
+    self.assertListEqual(await self.kv.test_bits('missing', [0]), [False])
+
+    self.assertEqual(await self.kv.set_bits('a', [0, 1], False), 1)
+    self.assertDictEqual(await self.kv.count_bits(['a', 'missing']), {'a':3})
+    self.assertDictEqual(await self.kv.count_bits(['a'], start=4, stop=101), {'a':2})
+
+    # a bytes value is a bitmap
+    await self.kv.set({'b':bytes([0xFF] * 20)})
+    self.assertDictEqual(await self.kv.count_bits(['a', 'b'], start=8), {'a':2, 'b':152})
+
+    self.assertEqual(await self.kv.bit_op('and', 'r', ['a', 'b']), 3)
+    self.assertEqual(await self.kv.bit_op('or', 'r', ['a', 'b']), 160)
+    self.assertEqual(await self.kv.bit_op('xor', 'r', ['a', 'b']), 157)
+    self.assertEqual(await self.kv.bit_op('and_not', 'r', ['b', 'a', 'missing']), 157)
+    self.assertEqual(await self.kv.get_sizes(['r']), {'r':20})
+    self.assertEqual(await self.kv.bit_op('and', 'a', ['a', 'missing']), 0)
+
+    # not a bitmap
+    await self.kv.set({'s':'abc'})
+    with self.assertRaises(ResponseError):
+      await self.kv.set_bits('s', [0])
+    with self.assertRaises(ResponseError):
+      await self.kv.test_bits('s', [0])
+    with self.assertRaises(ResponseError):
+      await self.kv.bit_op('or', 'r', ['a', 's'])
+    self.assertDictEqual(await self.kv.count_bits(['s']), {})
+
+    # a bitmap can't be larger than 2^28 bits
+    with self.assertRaises(ResponseError):
+      await self.kv.set_bits('a', [2**28])
+
+    # a HyperLogLog is a blob, but not a bitmap
+    await self.kv.hll_add('hll', ['x', 'y'])
+    with self.assertRaises(ResponseError):
+      await self.kv.set_bits('hll', [0])
+    with self.assertRaises(ResponseError):
+      await self.kv.bit_op('or', 'r', ['a', 'hll'])
+    with self.assertRaises(ResponseError):
+      await self.kv.bit_op('or', 'hll', ['a'])
+    self.assertDictEqual(await self.kv.append({'hll':bytes([1])}), {})
+    self.assertDictEqual(await self.kv.write_at({'hll':bytes([1])}, {'hll':0}), {})
+    self.assertEqual(await self.kv.hll_count(['hll']), 2)
+
+
+  async def test_hll(self):
+    # request payload is limited, so added in batches
+    for start in range(0, 5000, 500):
+      self.assertTrue(await self.kv.hll_add('a', list(range(start, start+500))))
+    self.assertFalse(await self.kv.hll_add('a', [1, 2, 3]))
+    self.assertAlmostEqual(await self.kv.hll_count(['a']), 5000, delta=250)
+    self.assertLessEqual((await self.kv.get_sizes(['a']))['a'], 4100)
+
+    # few items are sparse
+    self.assertTrue(await self.kv.hll_add('b', ['x', 'y', 'z', 'x']))
+    self.assertEqual(await self.kv.hll_count(['b']), 3)
+    self.assertLess((await self.kv.get_sizes(['b']))['b'], 100)
+    self.assertEqual(await self.kv.hll_count(['missing']), 0)
+
+    # union, overlapping items
+    await self.kv.hll_add('c', list(range(4000, 7000)))
+    self.assertAlmostEqual(await self.kv.hll_count(['a', 'c', 'missing']), 7000, delta=350)
+    self.assertAlmostEqual(await self.kv.hll_merge('a', ['a', 'b', 'c']), 7003, delta=350)
+    self.assertEqual(await self.kv.hll_count(['a']), await self.kv.hll_count(['a', 'b', 'c']))
+
+    # in a group
+    await self.kv.hll_add('g', ['x'], group='hll')
+    self.assertEqual(await self.kv.hll_count(['g'], group='hll'), 1)
+
+    # not a HyperLogLog
+    await self.kv.set({'s':'abc', 'blob':bytes([1,2,3])})
+    with self.assertRaises(ResponseError):
+      await self.kv.hll_add('s', ['x'])
+    with self.assertRaises(ResponseError):
+      await self.kv.hll_add('blob', ['x'])
+    with self.assertRaises(ResponseError):
+      await self.kv.hll_count(['b', 'blob'])
+
+
+  async def test_nearest(self):
+    # 20 elements so both the lanes and the remainder are used
+    def vec(*head):
+      return [float(v) for v in head] + [0.0] * (20 - len(head))
+
+    await self.kv.set({'x':vec(1), 'y':vec(0, 1), 'xy':vec(1, 1), 'far':vec(10, 9), 'zero':vec(),
+                       'short':[1.0, 0.0], 'ints':[1] + [0] * 19, 's':'abc'}, group='emb')
+
+    nearest = await self.kv.nearest(vec(1, 0.1), 2, group='emb')
+    self.assertListEqual([key for key, _ in nearest], ['x', 'far'])
+    self.assertAlmostEqual(nearest[0][1], 1 / (1.01 ** 0.5), places=5)
+
+    # cosine ignores magnitude, zero vectors are skipped
+    nearest = await self.kv.nearest(vec(1, 1), 10, group='emb')
+    self.assertListEqual([key for key, _ in nearest][:2], ['xy', 'far'])
+    self.assertListEqual(sorted(key for key, _ in nearest[2:]), ['x', 'y'])
+
+    nearest = await self.kv.nearest(vec(1, 1), 1, metric='dot', group='emb')
+    self.assertListEqual(nearest, [('far', 19.0)])
+
+    nearest = await self.kv.nearest(vec(1, 1), 3, metric='l2', group='emb', threads=4)
+    self.assertEqual(nearest[0], ('xy', 0.0))
+    self.assertListEqual(sorted(key for key, _ in nearest[1:]), ['x', 'y'])
+    self.assertAlmostEqual(nearest[1][1], 1.0)
+    self.assertEqual(len(await self.kv.nearest(vec(1, 1), 10, metric='l2', group='emb')), 5)
+    # k larger than the group, up to the max uint32
+    self.assertEqual(len(await self.kv.nearest(vec(1, 1), 2**32 - 1, metric='l2', group='emb')), 5)
+
+    # no vectors of this length
+    self.assertListEqual(await self.kv.nearest([1.0, 2.0, 3.0], 5, group='emb'), [])
+
+    with self.assertRaises(ResponseError):
+      await self.kv.nearest(vec(1), 1, group='missing')
+
+
+  async def test_vector_widths(self):
+    # the client encodes at the minimum width, which the server widens
+    data = {'i8':[-1,2,-3], 'i16':[-300,1], 'i32':[-70000,1], 'i64':[-2**40, 2**62],
+            'large':list(range(-1000, 1000)), 'floats':[0.5, -1.25], 'bools':[True, False, True]}
+
+    await self.kv.set(data)
+    self.assertDictEqual(await self.kv.get(keys=list(data.keys())), data)
+    self.assertListEqual(await self.kv.get_key('large'), list(range(-1000, 1000)))
+
+    # the server writes at the minimum width, so check either side of each width
+    bounds = {'b8':[-128, 127], 'b16':[-129, 128], 'b32':[-2**31, 2**31-1], 'b64':[-2**31-1, 2**31],
+              'manybools':[i % 3 == 0 for i in range(300)]}
+
+    await self.kv.set(bounds)
+    self.assertDictEqual(await self.kv.get(keys=list(bounds.keys())), bounds)
+
+
+  async def test_chunked(self):
+    # larger than the default max payload
+    data = bytes(i % 251 for i in range(100_000))
+
+    await self.kv.set_chunked('big', data, chunk_size=4000)
+    self.assertEqual(await self.kv.get_chunked('big', chunk_size=30_000), data)
+    self.assertEqual(await self.kv.get_sizes(['big']), {'big':len(data)})
+
+    chunks = [chunk async for chunk in self.kv.get_chunks('big', chunk_size=40_000)]
+    self.assertListEqual([len(c) for c in chunks], [40_000, 40_000, 20_000])
+
+    # in a group, and replacing an existing value
+    await self.kv.set({'blob':bytes([1,2,3])}, group='chunked')
+    await self.kv.set_chunked('blob', data[:5000], group='chunked', chunk_size=1000)
+    self.assertEqual(await self.kv.get_key('blob', group='chunked'), data[:5000])
+
+    await self.kv.set_chunked('empty', b'')
+    self.assertEqual(await self.kv.get_chunked('empty'), b'')
+
+    # not a blob, and doesn't exist
+    await self.kv.set({'str':'abc'})
+    with self.assertRaises(ResponseError):
+      await self.kv.get_chunked('str')
+    with self.assertRaises(ResponseError):
+      await self.kv.get_chunked('_dont_exist')
+
+
+  async def test_chunked_abandoned(self):
+    # uploads left open by a client are aborted when it disconnects
+    client = await fcache('ws://127.0.0.1:1987')
+    kv = KV(client)
+
+    for i in range(64):
+      await kv._do_chunk_begin(f'abandoned{i}', 1000, 'uploads' if i % 2 else None)
+
+    # the max uploads are in progress
+    with self.assertRaises(ResponseError):
+      await self.kv.set_chunked('blob', bytes(10))
+
+    await client.close()
+    await asyncio.sleep(0.1)
+
+    await self.kv.set_chunked('blob', bytes(10))
+    self.assertEqual(await self.kv.get_key('blob'), bytes(10))
+
+
   ## Errors
   async def test_set_list_types(self):
     with self.assertRaises(ValueError):
       await self.kv.set({'strings':['hello', 123]})
 
 
+  async def test_incr_types(self):
+    with self.assertRaises(ValueError):
+      await self.kv.incr({'count':1.5})
+
+
 if __name__ == "__main__":
   unittest.main()
\ No newline at end of file
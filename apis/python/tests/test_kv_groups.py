@@ -157,5 +157,179 @@ class KVGroups(KvTest):
     self.assertIsNone(await self.kv.get(key='irrelevant', group='_dont_exist'))
 
 
+  async def test_scan(self):
+    data = {f'user:{i}':i for i in range(250)}
+    data.update({f'other:{i}':i for i in range(50)})
+    await self.kv.set(data, group='g1')
+
+    # all keys
+    cursor, out = 0, {}
+    while True:
+      cursor, page = await self.kv.scan(cursor, count=64, group='g1')
+      self.assertLessEqual(len(page), 64)
+      out.update(page)
+      if cursor == 0:
+        break
+    self.assertDictEqual(out, data)
+
+    # keys only, with pattern
+    cursor, keys = 0, []
+    while True:
+      cursor, page = await self.kv.scan(cursor, count=100, match='other:*', keys_only=True, group='g1')
+      keys.extend(page)
+      if cursor == 0:
+        break
+    self.assertCountEqual(keys, [f'other:{i}' for i in range(50)])
+
+    # group doesn't exist
+    self.assertEqual(await self.kv.scan(group='none'), (0, {}))
+
+
+  async def test_ordered_group(self):
+    await self.kv.create_group('ordered', ordered=True)
+    await self.kv.create_group('ordered', ordered=True, fail_on_duplicate=False)
+
+    with self.assertRaises(ResponseError):
+      await self.kv.create_group('ordered')
+
+    await self.kv.set({'t:2:b':2, 't:1:a':1, 't:1:b':True, 't:10':10, 'u:1':'x'}, group='ordered')
+    await self.kv.remove(key='t:1:b', group='ordered')
+
+    self.assertListEqual(await self.kv.get_prefix('t:1', group='ordered', keys_only=True), ['t:1:a', 't:10'])
+    self.assertDictEqual(await self.kv.get_prefix('t:1:', group='ordered'), {'t:1:a':1})
+    self.assertListEqual(await self.kv.get_prefix('t:', group='ordered', keys_only=True, limit=2), ['t:1:a', 't:10'])
+    
+    self.assertListEqual(await self.kv.range_keys('t:10', 'u', group='ordered'), ['t:10', 't:2:b'])
+    self.assertListEqual(await self.kv.range_keys('t:2', group='ordered'), ['t:2:b', 'u:1'])
+    self.assertListEqual(await self.kv.range_keys('u', 't', group='ordered'), [])
+
+    # index survives clearing keys
+    await self.kv.clear_group('ordered', delete_group=False)
+    await self.kv.set({'a':1}, group='ordered')
+    self.assertListEqual(await self.kv.range_keys('', group='ordered'), ['a'])
+    self.assertTrue((await self.kv.group_info('ordered'))['ordered'])
+
+    # group not ordered
+    await self.kv.set({'a':1}, group='unordered')
+    with self.assertRaises(ResponseError):
+      await self.kv.get_prefix('a', group='unordered')
+
+
+  async def test_encoded_group(self):
+    data = {'str':'hello', 'blob':bytes([0,1,2]), 'ints':[1,-2,3], 'floats':[1.5,2.5], 'strs':['a','bc'], 'int':5, 'bool':True}
+
+    await self.kv.create_group('encoded', encoded=True)
+    await self.kv.set(data, group='encoded')
+
+    self.assertTrue((await self.kv.group_info('encoded'))['encoded'])
+    self.assertDictEqual(await self.kv.get_all('encoded'), data)
+    self.assertEqual(await self.kv.get_key('ints', group='encoded'), [1,-2,3])
+    self.assertDictEqual(await self.kv.get_sizes(['str', 'ints', 'strs', 'int'], group='encoded'), {'str':5, 'ints':3, 'strs':2, 'int':1})
+
+    cursor, kv = await self.kv.scan(group='encoded')
+    self.assertEqual(cursor, 0)
+    self.assertDictEqual(kv, data)
+
+    # overwrite, and encoded values can't be appended to
+    await self.kv.set({'str':'bye'}, group='encoded')
+    self.assertEqual(await self.kv.get_key('str', group='encoded'), 'bye')
+    self.assertDictEqual(await self.kv.append({'str':'!'}, group='encoded'), {})
+
+
+  async def test_compressed_group(self):
+    json = '{"id":1,"name":"a","tags":["x","y"]},' * 100
+    blob = bytes(range(256)) * 8
+    small = 'abc'
+
+    await self.kv.create_group('compressed', compressed=True)
+    await self.kv.set({'json':json, 'blob':blob, 'small':small}, group='compressed')
+
+    self.assertDictEqual(await self.kv.get_all('compressed'), {'json':json, 'blob':blob, 'small':small})
+    self.assertDictEqual(await self.kv.get_sizes(['json', 'small'], group='compressed'), {'json':len(json), 'small':3})
+
+    info = await self.kv.group_info('compressed')
+    self.assertTrue(info['compressed'])
+    self.assertEqual(info['uncompressed_bytes'], len(json) + len(blob))
+    self.assertLess(info['compressed_bytes'] * 4, info['uncompressed_bytes'])
+
+    # replaced and removed values are no longer counted
+    await self.kv.set({'json':small}, group='compressed')
+    await self.kv.remove(key='blob', group='compressed')
+    info = await self.kv.group_info('compressed')
+    self.assertEqual(info['compressed_bytes'], 0)
+    self.assertEqual(info['uncompressed_bytes'], 0)
+
+    with self.assertRaises(ValueError):
+      await self.kv.create_group('both', encoded=True, compressed=True)
+
+
+  async def test_get_groups(self):
+    await self.kv.set({'name':'Bob', 'age':25}, group='user')
+    await self.kv.set({'theme':'dark', 'lang':'en'}, group='settings')
+    await self.kv.set({'ids':[1,2,3]}, group='recent')
+    await self.kv.set({'motd':'hello'})
+
+    result = await self.kv.get_groups({'user':['name'], 'settings':None, 'recent':[], '':['motd'], 'none':['a']})
+    self.assertDictEqual(result, {'user':{'name':'Bob'},
+                                  'settings':{'theme':'dark', 'lang':'en'},
+                                  'recent':{'ids':[1,2,3]},
+                                  '':{'motd':'hello'}})
+
+    await self.kv.create_group('encoded', encoded=True)
+    await self.kv.set({'s':'abc', 'v':[1.5]}, group='encoded')
+    self.assertDictEqual(await self.kv.get_groups({'encoded':[], 'user':['age']}), {'encoded':{'s':'abc', 'v':[1.5]}, 'user':{'age':25}})
+
+
+  async def test_swap_groups(self):
+    await self.kv.set({'a':1, 'b':2}, group='live')
+    await self.kv.create_group('staging', ordered=True)
+    await self.kv.set({'a':10, 'c':30}, group='staging')
+
+    await self.kv.swap_groups('live', 'staging')
+    self.assertDictEqual(await self.kv.get_all('live'), {'a':10, 'c':30})
+    self.assertDictEqual(await self.kv.get_all('staging'), {'a':1, 'b':2})
+    self.assertTrue((await self.kv.group_info('live'))['ordered'])
+    self.assertFalse((await self.kv.group_info('staging'))['ordered'])
+
+    await self.kv.swap_groups('live', 'staging', delete_other=True)
+    self.assertDictEqual(await self.kv.get_all('live'), {'a':1, 'b':2})
+    with self.assertRaises(ResponseError):
+      await self.kv.group_info('staging')
+
+    with self.assertRaises(ResponseError):
+      await self.kv.swap_groups('live', 'staging')
+
+
+  async def test_group_info(self):
+    await self.kv.set({'name':'Bob', 'age':25, 'city':'Paris'}, group='g1')
+
+    info = await self.kv.group_info('g1')
+    self.assertEqual(info['count'], 3)
+    self.assertGreater(info['bytes_used'], 0)
+    self.assertGreaterEqual(info['bytes_reserved'], info['bytes_used'])
+
+    await self.kv.clear_group('g1', delete_group=False)
+    self.assertEqual((await self.kv.group_info('g1'))['count'], 0)
+
+    with self.assertRaises(ResponseError):
+      await self.kv.group_info('_dont_exist')
+
+
+  async def test_reserve(self):
+    await self.kv.create_group('reserved', reserve=5000)
+    await self.kv.set({f'k{i}':i for i in range(1000)}, group='reserved')
+    await self.kv.set({f'k{i}':i for i in range(1000, 2000)}, group='reserved')
+    self.assertEqual((await self.kv.group_info('reserved'))['rehashes'], 0)
+
+    # grows from the default size, so is rehashed
+    await self.kv.set({f'k{i}':i for i in range(1000)}, group='unreserved')
+    info = await self.kv.group_info('unreserved')
+    self.assertGreater(info['rehashes'], 0)
+    self.assertGreaterEqual(info['rehash_total_us'], info['rehash_max_us'])
+
+    with self.assertRaises(ValueError):
+      await self.kv.create_group('invalid', reserve=-1)
+
+
 if __name__ == "__main__":
   unittest.main()
\ No newline at end of file
@@ -325,4 +325,37 @@ class UnsortedList(UnsortedListTest):
     self.assertEqual(size, 3)
 
 
+  async def test_get_range_if_changed(self):
+    await self.list.create('l', type='int')
+    await self.list.add('l', [0,1,2])
+
+    # version 0 always gets the range
+    items, version = await self.list.get_range_if_changed('l', 0, start=0)
+    self.assertListEqual(items, [0,1,2])
+    self.assertIsNone(await self.list.get_range_if_changed('l', version, start=0))
+
+    await self.list.add_tail('l', [3])
+    items, newVersion = await self.list.get_range_if_changed('l', version, start=0)
+    self.assertListEqual(items, [0,1,2,3])
+    self.assertNotEqual(newVersion, version)
+    self.assertIsNone(await self.list.get_range_if_changed('l', newVersion, start=1, stop=3))
+
+
+  async def test_memory(self):
+    await self.list.create('i', type='int')
+    await self.list.create('s', type='str')
+    self.assertEqual(await self.list.memory('i'), 0)
+
+    await self.list.add('i', [0,1,2])
+    await self.list.add('s', ['a', 'b', 'c'])
+    memory = await self.list.memory('i')
+    self.assertGreater(memory, 0)
+    self.assertGreater(await self.list.memory('s'), memory)
+
+    # a long string has its own allocation
+    shortMemory = await self.list.memory('s')
+    await self.list.add('s', ['x'*100])
+    self.assertGreater(await self.list.memory('s'), shortMemory + 100)
+
+
   # TODO delete, delete_all when exists() implemented
\ No newline at end of file
@@ -0,0 +1,43 @@
+import unittest
+from base import ServerTest
+
+
+class Server(ServerTest):
+  async def test_info(self):
+    info = await self.server.info()
+    self.assertIn('lazy_free_enabled', info)
+    self.assertIn('lazy_free_pending', info)
+    self.assertIn('lazy_free_freed', info)
+    self.assertIn('kv_fragmentation_ratio', info)
+    self.assertIn('defrag_runs', info)
+    self.assertIn('defrag_skipped_groups', info)
+    self.assertIn('defrag_skipped_bytes', info)
+
+
+  async def test_lazy_free(self):
+    info = await self.server.info()
+    
+    if info['lazy_free_enabled']:
+      freedBefore = info['lazy_free_freed']
+
+      await self.kv.set({'a':1, 'b':'xyz'}, group='g1')
+      await self.kv.clear_group('g1')
+
+      info = await self.server.info()
+      self.assertGreaterEqual(info['lazy_free_freed'] + info['lazy_free_pending'], freedBefore + 1)
+
+
+  async def test_large_values_freed(self):
+    # larger than the pool's largest block, so replaced values are freed rather than held until the group is cleared
+    await self.kv.set({'big':bytes(12_000)}, group='large')
+    reserved = (await self.server.info())['kv_bytes_reserved']
+
+    for i in range(50):
+      await self.kv.set({'big':bytes([i]) * 12_000}, group='large')
+
+    self.assertLessEqual((await self.server.info())['kv_bytes_reserved'], reserved + 12_000)
+    await self.kv.clear_group('large')
+
+
+if __name__ == "__main__":
+  unittest.main()
@@ -12,6 +12,7 @@
 #include <plog/Log.h>
 #include <plog/Appenders/ColorConsoleAppender.h>
 #include <ankerl/unordered_dense.h>
+#include <flatbuffers/flexbuffers.h>
 
 
 static plog::ColorConsoleAppender<fc::FcFormatter> consoleAppender;
@@ -185,7 +186,8 @@ struct Timer
 
 void perfPmr(const uint64_t nKeys, const uint64_t nValuesPerKey)
 {
-  std::pmr::polymorphic_allocator alloc{fc::MapMemory::getPool()};
+  fc::GroupMemory memory;
+  std::pmr::polymorphic_allocator alloc{memory.pool()};
   PmrMap map(alloc);
 
 
@@ -272,6 +274,76 @@ void perfPmr(const uint64_t nKeys, const uint64_t nValuesPerKey)
   PLOGI << total;
 }
 
+
+// Getting vector values, as KVGet does: serialising each element from the stored bytes,
+// versus copying a value which was encoded when set (a group created with 'encoded').
+void perfEncodedGet(const uint64_t nKeys, const uint64_t nValuesPerKey)
+{
+  std::vector<std::string> keys;
+  std::vector<std::vector<uint8_t>> raw;
+  std::vector<std::vector<uint8_t>> encoded;
+
+  for (uint64_t k = 0 ; k < nKeys ; ++k)
+  {
+    keys.emplace_back(std::to_string(k));
+
+    auto& vec = raw.emplace_back(nValuesPerKey*sizeof(int64_t));
+    
+    flexbuffers::Builder encoder;
+    encoder.TypedVector([&]
+    {
+      for (int64_t i = 0 ; i < static_cast<int64_t>(nValuesPerKey) ; ++i)
+      {
+        std::memcpy(vec.data() + i*sizeof(int64_t), &i, sizeof(int64_t));
+        encoder.Add(i);
+      }
+    });
+    encoder.Finish();
+    encoded.emplace_back(encoder.GetBuffer());
+  }
+
+
+  flexbuffers::Builder fb{nKeys * nValuesPerKey * sizeof(int64_t)};
+
+  {
+    Timer t{"Get per element"};
+
+    fb.Map([&]
+    {
+      for (uint64_t k = 0 ; k < nKeys ; ++k)
+      {
+        fb.TypedVector(keys[k].c_str(), [&data = raw[k], &fb]
+        {
+          for (std::size_t i = 0 ; i < data.size() ; i += sizeof(int64_t))
+          {
+            int64_t v{};
+            std::memcpy(&v, data.data()+i, sizeof(int64_t));
+            fb.Add(v);
+          }
+        });
+      }
+    });
+    fb.Finish();
+  }
+
+  PLOGI << "Per element size: " << fb.GetSize();
+  fb.Clear();
+
+  {
+    Timer t{"Get encoded"};
+
+    fb.Map([&]
+    {
+      for (uint64_t k = 0 ; k < nKeys ; ++k)
+        fb.Blob(keys[k].c_str(), encoded[k].data(), encoded[k].size());
+    });
+    fb.Finish();
+  }
+
+  PLOGI << "Encoded size: " << fb.GetSize();
+}
+
+
 /*  Commented because ListMemory resource removed:
 
 // https://quick-bench.com/q/GEtDNQybceEUt1cGsxRBDzwF22c
@@ -464,6 +536,8 @@ int main (int argc, char ** argv)
   
   // perfNormal(100000, 10);
   // perfPmr(100000, 10);
+
+  perfEncodedGet(10000, 100);
   
   //perfList(10000);
   //perfListPmr(10);
@@ -5,7 +5,10 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <getopt.h>
+#include <algorithm>
+#include <limits>
 #include <latch>
+#include <optional>
 #include <tuple>
 
 
@@ -18,6 +21,8 @@ static unsigned int MinPayload = 64;
 static unsigned int MaxPayload = 8 * 1024*1024; 
 // having default too low will cause confusion
 static unsigned int DefaultPayload = 16 * 1024;
+// a chunked upload can't declare a larger blob than this
+static std::size_t DefaultMaxBlobSize = 512U * 1024U * 1024U;
 
 
 static void kvSigHandle(int param)
@@ -26,28 +31,77 @@ static void kvSigHandle(int param)
 }
 
 
+struct Settings
+{
+  bool valid{true};
+  std::string ip{"127.0.0.1"};
+  int port {1987};
+  unsigned int maxPayload{DefaultPayload};
+  bool lazyFree{false};
+  bool defrag{false};
+  std::optional<std::size_t> poolMaxBlocks;
+  std::optional<std::size_t> poolLargestBlock;
+  std::optional<std::size_t> poolInitialSize;
+  std::size_t prefault{0};
+  std::string poolHistogram;
+  std::size_t maxBlobSize{DefaultMaxBlobSize};
+};
+
+
 void usage()
 {
-  PLOGE <<  "\n--ip <ipv4>        The IPv4 address for the server (default 127.0.0.1)\n"
-            "--port <p>         Port (default: 1987)\n"
-            "--maxPayload <n>   Max bytes accepted by the WebSocket server";
+  PLOGE <<  "\n--ip <ipv4>               The IPv4 address for the server (default 127.0.0.1)\n"
+            "--port <p>                Port (default: 1987)\n"
+            "--maxPayload <n>          Max bytes accepted by the WebSocket server\n"
+            "--lazyFree                Free memory of deleted/cleared groups and lists on a background thread\n"
+            "--defrag                  When idle, compact fragmented groups and return free memory to the OS\n"
+            "--poolMaxBlocks <n>       Group memory: pool_options::max_blocks_per_chunk\n"
+            "--poolLargestBlock <n>    Group memory: pool_options::largest_required_pool_block\n"
+            "--poolInitialSize <n>     Group memory: size of the first buffer allocated for a group (default 1024)\n"
+            "--prefault <n>            Bytes to allocate and touch at startup. The memory is kept by malloc\n"
+            "                          for later allocations, until --defrag returns free memory to the OS\n"
+            "--poolHistogram <path>    Record allocation sizes to this file at shutdown. If it exists at startup,\n"
+            "                          pool options are derived from it (unless set with the options above)\n"
+            "--maxBlobSize <n>         Max bytes of a blob set with a chunked upload, or a string or blob grown by append\n"
+            "                          or write at (default 512MB)";
 }
 
 
-std::tuple<bool, std::string, int, unsigned long> getCmdArgs(int argc, char ** argv)
+bool toSize (const std::string_view name, const char * arg, std::size_t& size)
+{
+  if (std::string s{arg} ; s.empty() || std::any_of(s.cbegin(), s.cend(), [](const auto c){ return !std::isdigit(c);}))
+  {
+    PLOGE << name << ": can only contain numbers";
+    return false;
+  }
+  else
+  {
+    size = std::stoul(s);
+    return true;
+  }
+}
+
+
+Settings getCmdArgs(int argc, char ** argv)
 {
   option opts[] = 
   {
     {"ip",  optional_argument, NULL, 0},
     {"port",  optional_argument, NULL, 1},
     {"maxPayload", optional_argument, NULL, 2},
+    {"lazyFree", no_argument, NULL, 3},
+    {"defrag", no_argument, NULL, 4},
+    {"poolMaxBlocks", required_argument, NULL, 5},
+    {"poolLargestBlock", required_argument, NULL, 6},
+    {"prefault", required_argument, NULL, 7},
+    {"poolHistogram", required_argument, NULL, 8},
+    {"maxBlobSize", required_argument, NULL, 9},
+    {"poolInitialSize", required_argument, NULL, 10},
     {NULL, 0, NULL, 0}
   };
 
-  bool valid = true;
-  std::string ip{"127.0.0.1"};
-  int port {1987};
-  unsigned int maxPayload{DefaultPayload};
+  Settings settings;
+  bool& valid = settings.valid;
 
   try
   {
@@ -56,11 +110,11 @@ std::tuple<bool, std::string, int, unsigned long> getCmdArgs(int argc, char ** a
       switch (opt)
       {
       case 0:
-        ip = optarg;
+        settings.ip = optarg;
       break;
       
       case 1:
-        port = std::stoi(optarg);
+        settings.port = std::stoi(optarg);
       break;
       
       case 2:
@@ -77,7 +131,54 @@ std::tuple<bool, std::string, int, unsigned long> getCmdArgs(int argc, char ** a
           PLOGW_IF(size < MinPayload) << "maxPayload below minimum, setting to " << MinPayload;
           PLOGW_IF(size > MaxPayload) << "maxPayload exceeds maximum, setting to " << MaxPayload;
 
-          maxPayload = std::clamp<unsigned int>(size, MinPayload, MaxPayload);  
+          settings.maxPayload = std::clamp<unsigned int>(size, MinPayload, MaxPayload);  
+        }
+      break;
+
+      case 3:
+        settings.lazyFree = true;
+      break;
+
+      case 4:
+        settings.defrag = true;
+      break;
+
+      case 5:
+        if (!toSize("poolMaxBlocks", optarg, settings.poolMaxBlocks.emplace()))
+          valid = false;
+      break;
+
+      case 6:
+        if (!toSize("poolLargestBlock", optarg, settings.poolLargestBlock.emplace()))
+          valid = false;
+      break;
+
+      case 7:
+        if (!toSize("prefault", optarg, settings.prefault))
+          valid = false;
+      break;
+
+      case 8:
+        settings.poolHistogram = optarg;
+      break;
+
+      case 9:
+        if (!toSize("maxBlobSize", optarg, settings.maxBlobSize))
+          valid = false;
+        else
+        {
+          PLOGW_IF(settings.maxBlobSize > std::numeric_limits<fc::fcblobsize>::max()) << "maxBlobSize exceeds maximum, setting to " << std::numeric_limits<fc::fcblobsize>::max();
+          settings.maxBlobSize = std::min<std::size_t>(settings.maxBlobSize, std::numeric_limits<fc::fcblobsize>::max());
+        }
+      break;
+
+      case 10:
+        if (!toSize("poolInitialSize", optarg, settings.poolInitialSize.emplace()))
+          valid = false;
+        else
+        {
+          PLOGW_IF(*settings.poolInitialSize == 0) << "poolInitialSize can't be 0, setting to 1";
+          settings.poolInitialSize = std::max<std::size_t>(*settings.poolInitialSize, 1U);
         }
       break;
 
@@ -95,7 +196,44 @@ std::tuple<bool, std::string, int, unsigned long> getCmdArgs(int argc, char ** a
   if (!valid)
     usage();
 
-  return {valid, ip, port, maxPayload};
+  return settings;
+}
+
+
+// Sets the pool options for group memory: command line values take priority,
+// then those derived from the histogram, otherwise the std library defaults.
+void initMemory(const Settings& settings)
+{
+  auto& options = fc::MemoryOptions::defaults();
+
+  if (!settings.poolHistogram.empty())
+  {
+    auto& histogram = fc::AllocHistogram::get();
+    histogram.enable();
+
+    if (histogram.load(settings.poolHistogram))
+    {
+      if (const auto derived = histogram.deriveOptions(); derived)
+      {
+        options.pool = *derived;
+        PLOGI << "Pool options derived from " << settings.poolHistogram;
+      }
+    }
+  }
+
+  if (settings.poolMaxBlocks)
+    options.pool.max_blocks_per_chunk = *settings.poolMaxBlocks;
+  
+  if (settings.poolLargestBlock)
+    options.pool.largest_required_pool_block = *settings.poolLargestBlock;
+
+  if (settings.poolInitialSize)
+    options.initialSize = *settings.poolInitialSize;
+
+  if (settings.prefault)
+  {
+    PLOGW_IF(!fc::prefault(settings.prefault)) << "Failed to prefault " << settings.prefault << " bytes";
+  }
 }
 
 
@@ -107,17 +245,18 @@ int main (int argc, char ** argv)
   signal(SIGTERM, kvSigHandle);
   signal(SIGKILL, kvSigHandle);
   
-  // TODO warm up memory pools
-    
-  const auto [valid, ip, port, maxPayload] = getCmdArgs(argc, argv);
+  const auto settings = getCmdArgs(argc, argv);
+  const auto& [valid, ip, port, maxPayload, lazyFree, defrag] = std::tie(settings.valid, settings.ip, settings.port, settings.maxPayload, settings.lazyFree, settings.defrag);
   
   if (!valid)
     return 1;
 
+  initMemory(settings);
+
 
   fc::Server server;
 
-  if (!server.init())
+  if (!server.init(lazyFree, defrag, settings.maxBlobSize))
   {
     PLOGF << "Failed to initialise websocket server";
   }
@@ -127,6 +266,12 @@ int main (int argc, char ** argv)
     {
       PLOGI << "Listening on " << ip << ":" << port;
       PLOGI << "Max payload: " << maxPayload << " bytes";
+      PLOGI << "Lazy free: " << std::boolalpha << lazyFree;
+      PLOGI << "Defrag: " << std::boolalpha << defrag;
+      PLOGI << "Max blob size: " << settings.maxBlobSize << " bytes";
+      PLOGI << "Pool options: max blocks per chunk: " << fc::MemoryOptions::defaults().pool.max_blocks_per_chunk << 
+                             ", largest pool block: " << fc::MemoryOptions::defaults().pool.largest_required_pool_block <<
+                             ", initial size: " << fc::MemoryOptions::defaults().initialSize;
       PLOGI << "fcache started";
       run.wait();
     }
@@ -137,6 +282,11 @@ int main (int argc, char ** argv)
     }
   }
 
+  if (!settings.poolHistogram.empty())
+  {
+    PLOGW_IF(!fc::AllocHistogram::get().save(settings.poolHistogram)) << "Failed to save allocation histogram to " << settings.poolHistogram;
+  }
+
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <fc/FlatBuffers.hpp>
+#include <fc/TypedVector.hpp>
+
+
+namespace fc
+{
+  struct Aggregation
+  {
+    fc::request::AggregateOp op;
+    double threshold{0};
+    std::span<const double> operand;
+  };
+
+
+  // Reductions over the array of a stored int, uint or float vector value, read with fc::load().
+  namespace aggregate
+  {
+    constexpr std::size_t Lanes = 8U;
+
+    // floats are summed in double, ints and uints exactly in 128 bits, because a sum of 64 bit values can overflow
+    template<typename T>
+    using AccumulatorT = std::conditional_t<std::is_floating_point_v<T>, double,
+                                            std::conditional_t<std::is_signed_v<T>, __int128, unsigned __int128>>;
+
+
+    template<typename T>
+    AccumulatorT<T> sum (const std::uint8_t * data, const std::size_t size) noexcept
+    {
+      using AccT = AccumulatorT<T>;
+
+      if constexpr (std::is_floating_point_v<T>)
+      {
+        AccT lanes[Lanes]{};
+        std::size_t i = 0;
+
+        for ( ; i + Lanes <= size ; i += Lanes)
+        {
+          for (std::size_t l = 0 ; l < Lanes ; ++l)
+            lanes[l] += static_cast<AccT>(load<T>(data, i+l));
+        }
+
+        AccT total{};
+        for (const auto lane : lanes)
+          total += lane;
+
+        for ( ; i < size ; ++i)
+          total += static_cast<AccT>(load<T>(data, i));
+
+        return total;
+      }
+      else
+      {
+        // 128 bit adds don't vectorise, so each value is split into its high and low 32 bits, which
+        // are summed in 64 bits. These can't overflow for fewer than 2^32 values (a 32GB vector).
+        using HighT = std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>;
+
+        HighT high[Lanes]{};
+        std::uint64_t low[Lanes]{};
+        std::size_t i = 0;
+
+        for ( ; i + Lanes <= size ; i += Lanes)
+        {
+          for (std::size_t l = 0 ; l < Lanes ; ++l)
+          {
+            const auto v = load<T>(data, i+l);
+            high[l] += static_cast<HighT>(v >> 32);  // arithmetic shift for signed
+            low[l] += static_cast<std::uint32_t>(v);
+          }
+        }
+
+        HighT highTotal{0};
+        std::uint64_t lowTotal{0};
+
+        for (std::size_t l = 0 ; l < Lanes ; ++l)
+        {
+          highTotal += high[l];
+          lowTotal += low[l];
+        }
+
+        for ( ; i < size ; ++i)
+        {
+          const auto v = load<T>(data, i);
+          highTotal += static_cast<HighT>(v >> 32);
+          lowTotal += static_cast<std::uint32_t>(v);
+        }
+
+        return static_cast<AccT>(highTotal) * (AccT{1} << 32) + static_cast<AccT>(lowTotal);
+      }
+    }
+
+
+    // size must be > 0
+    template<typename T, bool IsMin>
+    T minMax (const std::uint8_t * data, const std::size_t size) noexcept
+    {
+      T lanes[Lanes];
+      std::fill_n(lanes, Lanes, load<T>(data, 0));
+
+      std::size_t i = 0;
+
+      for ( ; i + Lanes <= size ; i += Lanes)
+      {
+        for (std::size_t l = 0 ; l < Lanes ; ++l)
+        {
+          const auto v = load<T>(data, i+l);
+          if constexpr (IsMin)
+            lanes[l] = v < lanes[l] ? v : lanes[l];
+          else
+            lanes[l] = v > lanes[l] ? v : lanes[l];
+        }
+      }
+
+      T result = IsMin ? *std::min_element(lanes, lanes + Lanes) : *std::max_element(lanes, lanes + Lanes);
+
+      for ( ; i < size ; ++i)
+      {
+        const auto v = load<T>(data, i);
+        result = IsMin ? std::min(result, v) : std::max(result, v);
+      }
+
+      return result;
+    }
+
+
+    template<typename T>
+    std::uint64_t countAbove (const std::uint8_t * data, const std::size_t size, const double threshold) noexcept
+    {
+      std::uint64_t lanes[Lanes]{};
+      std::size_t i = 0;
+
+      for ( ; i + Lanes <= size ; i += Lanes)
+      {
+        for (std::size_t l = 0 ; l < Lanes ; ++l)
+          lanes[l] += static_cast<double>(load<T>(data, i+l)) > threshold;
+      }
+
+      std::uint64_t total{0};
+      for (const auto lane : lanes)
+        total += lane;
+
+      for ( ; i < size ; ++i)
+        total += static_cast<double>(load<T>(data, i)) > threshold;
+
+      return total;
+    }
+
+
+    // operand must have size elements
+    template<typename T>
+    double dot (const std::uint8_t * data, const std::size_t size, const std::span<const double> operand) noexcept
+    {
+      double lanes[Lanes]{};
+      std::size_t i = 0;
+
+      for ( ; i + Lanes <= size ; i += Lanes)
+      {
+        for (std::size_t l = 0 ; l < Lanes ; ++l)
+          lanes[l] += static_cast<double>(load<T>(data, i+l)) * operand[i+l];
+      }
+
+      double total{0};
+      for (const auto lane : lanes)
+        total += lane;
+
+      for ( ; i < size ; ++i)
+        total += static_cast<double>(load<T>(data, i)) * operand[i];
+
+      return total;
+    }
+  }
+}
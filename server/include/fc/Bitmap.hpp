@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <fc/FlatBuffers.hpp>
+#include <fc/TypedVector.hpp>
+
+
+namespace fc
+{
+  // A bitmap is a blob value, where bit n is bit (n % 8) of byte (n / 8).
+  //
+  // Words are read with fc::load(). The server is built with -march=native, so std::popcount is a
+  // POPCNT instruction, and the loops are simple enough for the compiler to vectorise.
+  namespace bitmap
+  {
+    constexpr std::size_t Lanes = 4U;
+    constexpr std::size_t WordSize = sizeof(std::uint64_t);
+
+    // Bitmaps are dense, so setting one high bit allocates every byte below it. This bounds the memory
+    // a small request can allocate to 32MB, rather than Redis's 512MB.
+    constexpr std::uint64_t MaxBits = std::uint64_t{1} << 28;
+
+
+    inline void store (std::uint8_t * data, const std::uint64_t w) noexcept
+    {
+      std::memcpy(data, &w, WordSize);
+    }
+
+
+    inline bool test (const std::span<const std::uint8_t> bytes, const std::uint64_t bit) noexcept
+    {
+      return bit / 8 < bytes.size() && ((bytes[bit / 8] >> (bit % 8)) & 1U);
+    }
+
+
+    // Bits set in size bytes
+    inline std::uint64_t count (const std::uint8_t * data, const std::size_t size) noexcept
+    {
+      std::uint64_t lanes[Lanes]{};
+      std::size_t i = 0;
+
+      for ( ; i + Lanes*WordSize <= size ; i += Lanes*WordSize)
+      {
+        for (std::size_t l = 0 ; l < Lanes ; ++l)
+          lanes[l] += std::popcount(load<std::uint64_t>(data + i, l));
+      }
+
+      std::uint64_t total{0};
+      for (const auto lane : lanes)
+        total += lane;
+
+      for ( ; i + WordSize <= size ; i += WordSize)
+        total += std::popcount(load<std::uint64_t>(data + i));
+
+      for ( ; i < size ; ++i)
+        total += std::popcount(data[i]);
+
+      return total;
+    }
+
+
+    // Bits set in the range [start, stop) of bits. Bits beyond the bitmap are not set.
+    inline std::uint64_t count (const std::span<const std::uint8_t> bytes, const std::uint64_t start, const std::uint64_t stop) noexcept
+    {
+      const auto end = std::min<std::uint64_t>(stop, bytes.size() * 8);
+
+      if (start >= end)
+        return 0;
+
+      // bytes with the first and last bits, which may be partially in the range
+      const auto first = start / 8;
+      const auto last = (end - 1) / 8;
+      const std::uint8_t firstMask = 0xFFU << (start % 8);
+      const std::uint8_t lastMask = 0xFFU >> (7 - (end - 1) % 8);
+
+      if (first == last)
+        return std::popcount(static_cast<std::uint8_t>(bytes[first] & firstMask & lastMask));
+      else
+        return std::popcount(static_cast<std::uint8_t>(bytes[first] & firstMask)) +
+               count(bytes.data() + first + 1, last - first - 1) +
+               std::popcount(static_cast<std::uint8_t>(bytes[last] & lastMask));
+    }
+
+
+    template<fc::request::BitOp Op, typename T>
+    inline T combine (const T a, const T b) noexcept
+    {
+      using enum fc::request::BitOp;
+
+      if constexpr (Op == BitOp_And)
+        return a & b;
+      else if constexpr (Op == BitOp_Or)
+        return a | b;
+      else if constexpr (Op == BitOp_Xor)
+        return a ^ b;
+      else
+        return a & static_cast<T>(~b);
+    }
+
+
+    // dest = dest op src, for size bytes
+    template<fc::request::BitOp Op>
+    void apply (std::uint8_t * dest, const std::uint8_t * src, const std::size_t size) noexcept
+    {
+      std::size_t i = 0;
+
+      for ( ; i + WordSize <= size ; i += WordSize)
+        store(dest + i, combine<Op>(load<std::uint64_t>(dest + i), load<std::uint64_t>(src + i)));
+
+      for ( ; i < size ; ++i)
+        dest[i] = combine<Op>(dest[i], src[i]);
+    }
+  }
+}
@@ -45,7 +45,7 @@ namespace fc
     }
 
     // need this because uWebSockets moves the userdata after upgrade to websocket
-    WsSession (WsSession&& other) : connected(other.connected)
+    WsSession (WsSession&& other) : connected(other.connected), id(other.id)
     {
       other.connected = false;
     }
@@ -55,6 +55,7 @@ namespace fc
     }
 
     bool connected;
+    std::uint64_t id{0};  // unique per connection, set when opened
   };
 
   
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+
+namespace fc
+{
+  // A HyperLogLog is a blob value: [H][L][L][encoding][registers]
+  //
+  // There are 2^Precision registers, each the max rank seen for items which hash to it, so the
+  // standard error is 1.04 / sqrt(Registers), about 1.6%.
+  //
+  // A counter begins sparse: only the non-zero registers are stored, as entries sorted by index,
+  // so a counter with few items is tens of bytes. When the entries would be larger than SparseMax
+  // the counter is converted to dense, which has a byte per register, so a counter is never larger
+  // than DenseSize.
+  //
+  // Functions which take a vector operate on the HyperLogLog at offset within the vector, so
+  // a blob's size can precede it.
+  namespace hll
+  {
+    constexpr std::size_t Precision = 12U;
+    constexpr std::size_t RegisterCount = std::size_t{1} << Precision;
+
+    constexpr std::uint8_t Sparse = 0U;
+    constexpr std::uint8_t Dense = 1U;
+
+    constexpr std::size_t HeaderSize = 4U;
+    constexpr std::size_t EntrySize = 3U;   // index as uint16, rank
+    constexpr std::size_t SparseMax = 340U; // entries, so sparse is at most ~1KB
+    constexpr std::size_t DenseSize = HeaderSize + RegisterCount;
+
+    using Registers = std::array<std::uint8_t, RegisterCount>;
+    using Data = std::pmr::vector<std::uint8_t>;
+
+
+    inline bool isHll (const std::span<const std::uint8_t> bytes) noexcept
+    {
+      if (bytes.size() < HeaderSize || bytes[0] != 'H' || bytes[1] != 'L' || bytes[2] != 'L')
+        return false;
+      else if (bytes[3] == Dense)
+        return bytes.size() == DenseSize;
+      else
+        return bytes[3] == Sparse && (bytes.size() - HeaderSize) % EntrySize == 0;
+    }
+
+
+    // The register for a hash is its top Precision bits. The rank is the position of the first
+    // set bit in the remaining bits, with a guard bit so the rank is at most 64 - Precision + 1.
+    inline std::pair<std::uint16_t, std::uint8_t> position (const std::uint64_t hash) noexcept
+    {
+      const auto index = static_cast<std::uint16_t>(hash >> (64U - Precision));
+      const auto rank = static_cast<std::uint8_t>(std::countl_zero((hash << Precision) | (std::uint64_t{1} << (Precision - 1U))) + 1);
+      return {index, rank};
+    }
+
+
+    inline std::uint16_t entryIndex (const std::uint8_t * entry) noexcept
+    {
+      std::uint16_t index;
+      std::memcpy(&index, entry, sizeof(index));
+      return index;
+    }
+
+
+    // Sets the registers to the max of themselves and hll's registers
+    inline void merge (const std::span<const std::uint8_t> hll, Registers& registers) noexcept
+    {
+      if (hll[3] == Dense)
+      {
+        for (std::size_t i = 0 ; i < RegisterCount ; ++i)
+          registers[i] = std::max(registers[i], hll[HeaderSize + i]);
+      }
+      else
+      {
+        for (std::size_t e = HeaderSize ; e < hll.size() ; e += EntrySize)
+        {
+          auto& reg = registers[entryIndex(hll.data() + e) % RegisterCount];
+          reg = std::max(reg, hll[e + 2]);
+        }
+      }
+    }
+
+
+    inline void init (Data& data, const std::size_t offset)
+    {
+      data.resize(offset + HeaderSize);
+      std::memcpy(data.data() + offset, "HLL", 3);
+      data[offset + 3] = Sparse;
+    }
+
+
+    // Replaces the HyperLogLog with registers, as sparse if there are few enough non-zero registers
+    inline void store (Data& data, const std::size_t offset, const Registers& registers)
+    {
+      const auto used = static_cast<std::size_t>(std::count_if(registers.cbegin(), registers.cend(), [](const auto r){ return r != 0; }));
+
+      init(data, offset);
+
+      if (used > SparseMax)
+      {
+        data[offset + 3] = Dense;
+        data.insert(data.end(), registers.cbegin(), registers.cend());
+      }
+      else
+      {
+        data.reserve(offset + HeaderSize + used * EntrySize);
+
+        for (std::uint16_t i = 0 ; i < RegisterCount ; ++i)
+        {
+          if (registers[i])
+          {
+            const std::uint8_t * index = reinterpret_cast<const std::uint8_t *>(&i);
+            data.insert(data.end(), {index[0], index[1], registers[i]});
+          }
+        }
+      }
+    }
+
+
+    // Returns true if a register changed
+    inline bool add (Data& data, const std::size_t offset, const std::uint64_t hash)
+    {
+      const auto [index, rank] = position(hash);
+
+      if (data[offset + 3] == Dense)
+      {
+        auto& reg = data[offset + HeaderSize + index];
+        const bool changed = rank > reg;
+        reg = std::max(reg, rank);
+        return changed;
+      }
+
+      // binary search of the sparse entries
+      const auto first = offset + HeaderSize;
+      std::size_t lo = 0, hi = (data.size() - first) / EntrySize;
+
+      while (lo < hi)
+      {
+        const auto mid = (lo + hi) / 2;
+
+        if (entryIndex(data.data() + first + mid*EntrySize) < index)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+
+      const auto pos = first + lo*EntrySize;
+
+      if (pos < data.size() && entryIndex(data.data() + pos) == index)
+      {
+        const bool changed = rank > data[pos + 2];
+        data[pos + 2] = std::max(data[pos + 2], rank);
+        return changed;
+      }
+      else if ((data.size() - first) / EntrySize == SparseMax)
+      {
+        Registers registers{};
+        merge(std::span{data.data() + offset, data.size() - offset}, registers);
+        registers[index] = rank;
+        store(data, offset, registers);
+      }
+      else
+      {
+        const std::uint8_t * indexBytes = reinterpret_cast<const std::uint8_t *>(&index);
+        data.insert(data.begin() + pos, {indexBytes[0], indexBytes[1], rank});
+      }
+
+      return true;
+    }
+
+
+    // Estimated cardinality, with linear counting when the estimate is small enough that empty
+    // registers are significant
+    inline std::uint64_t count (const Registers& registers) noexcept
+    {
+      constexpr double m = RegisterCount;
+      constexpr double alpha = 0.7213 / (1.0 + 1.079 / m);
+
+      double sum{0};
+      std::size_t zeroes{0};
+
+      for (const auto reg : registers)
+      {
+        sum += std::ldexp(1.0, -static_cast<int>(reg));
+        zeroes += reg == 0;
+      }
+
+      if (const auto estimate = alpha * m * m / sum; estimate <= 2.5 * m && zeroes)
+        return static_cast<std::uint64_t>(std::llround(m * std::log(m / static_cast<double>(zeroes))));
+      else
+        return static_cast<std::uint64_t>(std::llround(estimate));
+    }
+  }
+}
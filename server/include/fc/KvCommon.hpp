@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <variant>
+#include <cstring>
+#include <string_view>
+#include <ankerl/unordered_dense.h>
 #include <fc/FlatBuffers.hpp>
 #include <fc/Memory.hpp>
 #include <fc/Common.hpp>
@@ -10,12 +14,165 @@ namespace fc
   struct FixedValue;
   struct VectorValue;
 
-  using CachedKey = std::string;
   using KeyVector = flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>;  
   using ExtractFixedF = void (*)(FlexBuilder&, const char * key, const FixedValue&);
   using ExtractVectorF = void (*)(FlexBuilder&, const char * key, const VectorValue&);
 
 
+  // A key from a request, hashed once. Used for lookups so that the hash
+  // isn't recalculated on find() then again on try_emplace().
+  struct KeyView
+  {
+    explicit KeyView (const std::string_view k) noexcept :
+      key(k),
+      hash(ankerl::unordered_dense::hash<std::string_view>{}(k))
+    {
+    }
+
+    std::string_view key;
+    std::uint64_t hash;
+  };
+
+
+  // A key stored in the cache map.
+  // The key's hash, length and characters are in one block, allocated from the map's memory
+  // resource rather than the global heap: [hash][length][chars]['\0']
+  //
+  // - the hash is cached so a rehash never reads the key's characters
+  // - comparisons check the hash first, and the characters are in the same cache line
+  // - the map's slot is only two pointers, so slots are more densely packed than with std::string
+  class CachedKey
+  {
+    struct Header
+    {
+      std::uint64_t hash;
+      std::uint32_t length;
+    };
+
+  public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+
+    CachedKey (const KeyView& key, const allocator_type& alloc) : m_resource(alloc.resource())
+    {
+      create(key.key, key.hash);
+    }
+
+    CachedKey (const CachedKey& other, const allocator_type& alloc) : m_resource(alloc.resource())
+    {
+      create(other.view(), other.hash());
+    }
+
+    // keys within a map share a resource, so this usually doesn't allocate, but it does when
+    // moving to a different resource (i.e. compacting), so it isn't noexcept
+    CachedKey (CachedKey&& other, const allocator_type& alloc) : m_resource(alloc.resource())
+    {
+      if (*m_resource == *other.m_resource)
+        m_block = std::exchange(other.m_block, nullptr);
+      else
+        create(other.view(), other.hash());
+    }
+
+    CachedKey (CachedKey&& other) noexcept :
+      m_resource(other.m_resource),
+      m_block(std::exchange(other.m_block, nullptr))
+    {
+    }
+
+    CachedKey& operator= (CachedKey&& other) noexcept
+    {
+      if (this != &other)
+      {
+        release();
+        m_resource = other.m_resource;
+        m_block = std::exchange(other.m_block, nullptr);
+      }
+      return *this;
+    }
+
+    CachedKey (const CachedKey&) = delete;
+    CachedKey& operator= (const CachedKey&) = delete;
+
+    ~CachedKey()
+    {
+      release();
+    }
+
+
+    std::uint64_t hash() const noexcept { return header()->hash; }
+    std::size_t size() const noexcept { return header()->length; }
+    const char * c_str() const noexcept { return m_block + sizeof(Header); }
+    std::string_view view() const noexcept { return {c_str(), size()}; }
+
+    // bytes allocated for this key
+    static constexpr std::size_t allocSize (const std::size_t length) noexcept
+    {
+      return sizeof(Header) + length + 1;
+    }
+
+  private:
+    const Header * header() const noexcept
+    {
+      return reinterpret_cast<const Header *>(m_block);
+    }
+
+    void create (const std::string_view key, const std::uint64_t hash)
+    {
+      m_block = static_cast<char *>(m_resource->allocate(allocSize(key.size()), alignof(Header)));
+
+      const Header header{.hash = hash, .length = static_cast<std::uint32_t>(key.size())};
+      std::memcpy(m_block, &header, sizeof(Header));
+      std::memcpy(m_block + sizeof(Header), key.data(), key.size());
+      m_block[sizeof(Header) + key.size()] = '\0';
+    }
+
+    void release() noexcept
+    {
+      if (m_block)
+      {
+        m_resource->deallocate(m_block, allocSize(size()), alignof(Header));
+        m_block = nullptr;
+      }
+    }
+
+  private:
+    std::pmr::memory_resource * m_resource;
+    char * m_block{nullptr};
+  };
+
+
+  // Transparent so the map can be queried with a KeyView without creating a CachedKey
+  struct CachedKeyHash
+  {
+    using is_transparent = void;
+    using is_avalanching = void;
+
+    std::uint64_t operator()(const CachedKey& key) const noexcept { return key.hash(); }
+    std::uint64_t operator()(const KeyView& key) const noexcept { return key.hash; }
+  };
+
+
+  struct CachedKeyEqual
+  {
+    using is_transparent = void;
+
+    bool operator()(const CachedKey& a, const CachedKey& b) const noexcept
+    {
+      return a.hash() == b.hash() && a.view() == b.view();
+    }
+
+    bool operator()(const KeyView& a, const CachedKey& b) const noexcept
+    {
+      return a.hash == b.hash() && a.key == b.view();
+    }
+
+    bool operator()(const CachedKey& a, const KeyView& b) const noexcept
+    {
+      return operator()(b, a);
+    }
+  };
+
+
   struct FixedValue
   {
     template<typename ScalarT>
@@ -76,7 +233,7 @@ namespace fc
     }
 
     VectorValue (VectorValue&& other, const allocator_type& alloc) noexcept :
-      data(std::move(other.data)),
+      data(std::move(other.data), alloc),
       extract(other.extract),
       type(other.type)
     {    
@@ -88,11 +245,143 @@ namespace fc
     FlexType type;
   };
 
+
+  // A field of a HashValue. The name and a string value are allocated from the map's memory.
+  struct HashField
+  {
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+    using Value = std::variant<fcint, fcuint, fcfloat, fcbool, std::pmr::string>;
+
+
+    HashField (const std::string_view n, const allocator_type& alloc) :
+      name(n, alloc),
+      value(std::in_place_type<fcint>, 0)
+    {
+    }
+
+    HashField (const HashField& other, const allocator_type& alloc) :
+      name(other.name, alloc),
+      value(copyValue(other.value, alloc))
+    {
+    }
+
+    // allocates if alloc's resource differs from other's
+    HashField (HashField&& other, const allocator_type& alloc) :
+      name(std::move(other.name), alloc),
+      value(moveValue(std::move(other.value), alloc))
+    {
+    }
+
+    HashField(const HashField&) = default;
+    HashField(HashField&&) noexcept = default;
+
+    HashField& operator= (const HashField&) = default;
+    HashField& operator= (HashField&&) noexcept = default;
+
+
+    std::pmr::string name;
+    Value value;
+
+  private:
+    static Value copyValue (const Value& other, const allocator_type& alloc)
+    {
+      if (const auto str = std::get_if<std::pmr::string>(&other); str)
+        return Value{std::in_place_type<std::pmr::string>, *str, alloc};
+      else
+        return other;
+    }
+
+    static Value moveValue (Value&& other, const allocator_type& alloc)
+    {
+      if (auto str = std::get_if<std::pmr::string>(&other); str)
+        return Value{std::in_place_type<std::pmr::string>, std::move(*str), alloc};
+      else
+        return std::move(other);
+    }
+  };
+
+
+  // A map of field:value within one key's value, where a value is an int, uint, float, bool or string,
+  // so a field is changed without rewriting the whole value. Records have few fields, so they're in
+  // a vector and found with a linear search, which is more compact and faster than hashing for small sizes.
+  struct HashValue
+  {
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+
+    HashValue() = default;
+    HashValue(const HashValue&) = default;
+    HashValue(HashValue&&) noexcept = default;
+
+    HashValue& operator= (const HashValue&) = default;
+    HashValue& operator= (HashValue&&) noexcept = default;
+
+    explicit HashValue (const allocator_type& alloc) : fields(alloc)
+    {
+    }
+
+    HashValue (const HashValue& other, const allocator_type& alloc) : fields(other.fields, alloc)
+    {
+    }
+
+    HashValue (HashValue&& other, const allocator_type& alloc) : fields(std::move(other.fields), alloc)
+    {
+    }
+
+
+    HashField * find (const std::string_view name) noexcept
+    {
+      const auto it = std::find_if(fields.begin(), fields.end(), [name](const HashField& f){ return f.name == name; });
+      return it == fields.end() ? nullptr : &(*it);
+    }
+
+    const HashField * find (const std::string_view name) const noexcept
+    {
+      return const_cast<HashValue *>(this)->find(name);
+    }
+
+    // Returns the field, which is created as an fcint 0 if it doesn't exist
+    HashField& get (const std::string_view name)
+    {
+      if (auto field = find(name); field)
+        return *field;
+      else
+        return fields.emplace_back(name);
+    }
+
+    // Bytes used by the fields, including names and strings which are too long for the small string buffer
+    std::size_t bytes () const noexcept
+    {
+      static const auto smallCapacity = std::pmr::string{}.capacity();
+
+      const auto allocated = [](const std::pmr::string& s) -> std::size_t
+      {
+        return s.capacity() > smallCapacity ? s.capacity() + 1 : 0U;
+      };
+
+      std::size_t total = fields.capacity() * sizeof(HashField);
+
+      for (const auto& field : fields)
+      {
+        total += allocated(field.name);
+
+        if (const auto str = std::get_if<std::pmr::string>(&field.value); str)
+          total += allocated(*str);
+      }
+
+      return total;
+    }
+
+
+    std::pmr::vector<HashField> fields;
+  };
+
   
   struct CachedValue
   {
     inline static const std::uint8_t FIXED = 0;
     inline static const std::uint8_t VEC   = 1;
+    inline static const std::uint8_t HASH  = 2;
 
     using allocator_type = std::pmr::polymorphic_allocator<>;
 
@@ -133,19 +422,62 @@ namespace fc
     {
     }
 
-    CachedValue (const CachedValue& other, const allocator_type& alloc) noexcept : value(other.value)
+    CachedValue (HashValue&& v, const allocator_type& alloc) :
+      value(std::in_place_type<HashValue>, std::move(v), alloc),
+      valueType(HASH)
+    {
+    }
+
+    // The VectorValue's data or HashValue's fields are allocated with alloc, rather than copying the other's allocator
+    CachedValue (const CachedValue& other, const allocator_type& alloc) :
+      value(copyValue(other, alloc)),
+      valueType(other.valueType),
+      version(other.version)
     {    
     }
 
     CachedValue (CachedValue&& other, const allocator_type& alloc) noexcept :
       value(std::move(other.value)),
-      valueType(other.valueType)
+      valueType(other.valueType),
+      version(other.version)
     {    
     }
 
 
-    std::variant<FixedValue, VectorValue> value;
+    // Called whenever the value changes
+    void modified() noexcept
+    {
+      version = nextVersion();
+    }
+
+
+    using Value = std::variant<FixedValue, VectorValue, HashValue>;
+
+    Value value;
     std::uint8_t valueType;
+    std::uint64_t version{nextVersion()};
+
+  private:
+    // Versions are from a counter shared by all keys, rather than each key counting from 1, so a key
+    // which is removed then set again, or replaced by a clear or swap, doesn't repeat a version a client
+    // has seen. Keys only change on the event loop thread. Version 0 is never used because it means the
+    // key does not exist.
+    static std::uint64_t nextVersion() noexcept
+    {
+      static std::uint64_t last{0};
+      return ++last;
+    }
+
+
+    static Value copyValue (const CachedValue& other, const allocator_type& alloc)
+    {
+      if (other.valueType == VEC)
+        return Value{std::in_place_type<VectorValue>, std::get<VectorValue>(other.value), alloc};
+      else if (other.valueType == HASH)
+        return Value{std::in_place_type<HashValue>, std::get<HashValue>(other.value), alloc};
+      else
+        return Value{std::in_place_type<FixedValue>, std::get<FixedValue>(other.value)};
+    }
   };
   
 }
\ No newline at end of file
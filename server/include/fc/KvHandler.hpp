@@ -2,21 +2,152 @@
 
 #include <fc/FlatBuffers.hpp>
 #include <fc/Map.hpp>
+#include <fc/LazyFree.hpp>
+#include <fc/WorkerPool.hpp>
 #include <plog/Log.h>
 
 namespace fc
 {
   class KvHandler
   {
-    struct Group
+    // The CacheMap and everything it stores is allocated from the group's memory,
+    // so a group is dropped or cleared by releasing the memory in bulk. The CacheMap's
+    // destructor is never called, because it would only return memory to a pool
+    // which is about to be released.
+    class Group
     {
-      CacheMap kv;
+    public:
+      // A chunked upload, written to a value in the group's memory which is moved to the map when committed
+      struct Upload
+      {
+        std::string key;
+        VectorValue value;
+        std::size_t size;   // total bytes expected
+      };
+
+
+      explicit Group(const MemoryOptions& options = MemoryOptions::defaults(), const MapOptions& mapOptions = {}) :
+        m_options(options),
+        m_mapOptions(mapOptions),
+        m_memory(std::make_unique<GroupMemory>(m_options)),
+        m_kv(createMap(*m_memory, m_mapOptions))
+      {
+      }
+
+      Group(Group&& other) noexcept :
+        m_options(other.m_options),
+        m_mapOptions(other.m_mapOptions),
+        m_memory(std::move(other.m_memory)),
+        m_kv(std::exchange(other.m_kv, nullptr)),
+        m_uploads(std::move(other.m_uploads))
+      {
+      }
+
+      Group& operator=(Group&& other) noexcept
+      {
+        // this group's uploads are released while the memory they're allocated from still exists
+        m_uploads = std::move(other.m_uploads);
+        m_options = other.m_options;
+        m_mapOptions = other.m_mapOptions;
+        m_kv = std::exchange(other.m_kv, nullptr);
+        m_memory = std::move(other.m_memory);
+        return *this;
+      }
+
+      Group(const Group&) = delete;
+      Group& operator=(const Group&) = delete;
+
+
+      CacheMap& kv() noexcept { return *m_kv; }
+      const CacheMap& kv() const noexcept { return *m_kv; }
+
+      std::size_t bytesUsed() const noexcept { return m_memory->bytesUsed(); }
+      std::size_t bytesReserved() const noexcept { return m_memory->bytesReserved(); }
+      bool isOrdered() const noexcept { return m_mapOptions.ordered; }
+      bool isEncoded() const noexcept { return m_mapOptions.encoded; }
+      bool isCompressed() const noexcept { return m_mapOptions.compressed; }
+      bool hasUploads() const noexcept { return !m_uploads.empty(); }
+
+
+      // The upload's value is an empty blob of size bytes. Capacity is reserved as chunks arrive, rather
+      // than trusting the declared size, so an upload which is abandoned doesn't hold size bytes.
+      Upload& beginUpload (const std::uint64_t id, const std::string_view key, const fcblobsize size)
+      {
+        Upload upload{.key = std::string{key}, .value = VectorValue{VectorValue::allocator_type{m_memory->pool()}}, .size = size};
+        upload.value.data.resize(sizeof(fcblobsize));
+        std::memcpy(upload.value.data.data(), &size, sizeof(fcblobsize));
+
+        return m_uploads.insert_or_assign(id, std::move(upload)).first->second;
+      }
+
+      Upload * upload (const std::uint64_t id) noexcept
+      {
+        const auto it = m_uploads.find(id);
+        return it == m_uploads.end() ? nullptr : &it->second;
+      }
+
+      void endUpload (const std::uint64_t id)
+      {
+        m_uploads.erase(id);
+      }
+
+
+      // Remove all keys. Returns the previous memory, which releases the keys when destroyed.
+      std::unique_ptr<GroupMemory> clear()
+      {
+        m_uploads.clear();  // allocated from the memory about to be released
+
+        auto memory = std::make_unique<GroupMemory>(m_options);
+        m_kv = createMap(*memory, m_mapOptions);
+        return std::exchange(m_memory, std::move(memory));
+      }
+
+      // Copy keys and values to new memory, sized for what is used. Returns the previous memory,
+      // which is now fragmented free space. Uploads are not copied, so must not be compacted whilst
+      // there are uploads.
+      std::unique_ptr<GroupMemory> compact()
+      {
+        MemoryOptions options{m_options};
+        // large values don't use the monotonic resource
+        options.initialSize = std::max<std::size_t>(m_memory->bytesUsed() - m_memory->bytesLarge(), options.initialSize);
+
+        auto memory = std::make_unique<GroupMemory>(options);
+        m_kv = createMap(*memory, *m_kv);
+        return std::exchange(m_memory, std::move(memory));
+      }
+
+    private:
+      static CacheMap * createMap (GroupMemory& memory, const MapOptions& options)
+      {
+        std::pmr::polymorphic_allocator<> alloc{memory.pool()};
+        return alloc.new_object<CacheMap>(memory.pool(), options);
+      }
+
+      static CacheMap * createMap (GroupMemory& memory, const CacheMap& other)
+      {
+        std::pmr::polymorphic_allocator<> alloc{memory.pool()};
+        return alloc.new_object<CacheMap>(other, memory.pool());
+      }
+
+    private:
+      MemoryOptions m_options;
+      MapOptions m_mapOptions;
+      std::unique_ptr<GroupMemory> m_memory;
+      CacheMap * m_kv;
+      // after m_memory, so they're destroyed first
+      ankerl::unordered_dense::map<std::uint64_t, Upload> m_uploads;
     };
 
     using GroupMap = ankerl::unordered_dense::map<std::string, Group>;
   
   public:
-    KvHandler() = default;
+    // maxBlobSize: the largest blob a chunked upload can declare, or a string or blob can grow to with KVAppend/KVWriteAt
+    KvHandler(LazyFree& lazyFree, WorkerPool& workers, const std::size_t maxBlobSize) :
+      m_lazyFree(lazyFree),
+      m_workers(workers),
+      m_maxBlobSize(maxBlobSize)
+    {
+    }
 
 
   public:
@@ -28,6 +159,43 @@ namespace fc
     void handle(FlatBuilder& fbb, const fc::request::KVContains& req) noexcept;
     void handle(FlatBuilder& fbb, const fc::request::KVClear& req) noexcept;
     void handle(FlatBuilder& fbb, const fc::request::KVClearSet& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVGroupInfo& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVIncr& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVDecr& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVAddFloat& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVCas& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVAppend& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVWriteAt& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVScan& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVGroupCreate& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVGetPrefix& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVRangeKeys& req) noexcept;
+    // session is the connection's WsSession::id, which owns the upload
+    void handle(FlatBuilder& fbb, const fc::request::KVChunkBegin& req, const std::uint64_t session) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVChunkAppend& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVChunkCommit& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVChunkGet& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVGetGroups& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVAggregate& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVGroupSwap& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVInfo& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVFieldSet& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVFieldGet& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVFieldIncr& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVBitSet& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVBitTest& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVBitCount& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVBitOp& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVHllAdd& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVHllCount& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVHllMerge& req) noexcept;
+    void handle(FlatBuilder& fbb, const fc::request::KVNearest& req) noexcept;
+
+    // Compacts the most fragmented group, releasing its previous memory. Called when the server is idle.
+    void defrag() noexcept;
+    void metrics(FlexBuilder& flxb) const;
+    // Aborts the uploads a connection began, so an abandoned upload doesn't hold memory and a slot
+    void endSession(const std::uint64_t session) noexcept;
 
 
   private:
@@ -37,61 +205,8 @@ namespace fc
       bool valid = true;
       for (std::size_t i = 0 ; i < values.size() && valid; ++i)
       {
-        const auto& key = keys[i].AsString().str();
-        
-        switch (values[i].GetType())
-        {
-          using enum FlexType;
-
-          case FBT_INT:
-            valid = map.setOrAdd<IsSet, FBT_INT>(key, values[i].AsInt64());
-          break;
-          
-          case FBT_UINT:
-            valid = map.setOrAdd<IsSet, FBT_UINT>(key, values[i].AsUInt64());
-          break;
-
-          case FBT_BOOL:
-            valid = map.setOrAdd<IsSet, FBT_BOOL>(key, values[i].AsBool());
-          break;
-
-          case FBT_FLOAT:
-            valid = map.setOrAdd<IsSet, FBT_FLOAT>(key, values[i].AsFloat());
-          break;
-
-          case FBT_STRING:
-            valid = map.setOrAdd<IsSet>(key, values[i].AsString().c_str());
-          break;
-
-          case FBT_BLOB:
-            valid = map.setOrAdd<IsSet>(key, values[i].AsBlob());
-          break;
-
-          case FBT_VECTOR_INT:
-            valid = map.setOrAdd<IsSet, FBT_VECTOR_INT>(key, values[i].AsTypedVector());
-          break;
-
-          case FBT_VECTOR_UINT:
-            valid = map.setOrAdd<IsSet, FBT_VECTOR_UINT>(key, values[i].AsTypedVector());
-          break;
-
-          case FBT_VECTOR_FLOAT:
-            valid = map.setOrAdd<IsSet, FBT_VECTOR_FLOAT>(key, values[i].AsTypedVector());
-          break;
-
-          case FBT_VECTOR_BOOL:
-            valid = map.setOrAdd<IsSet, FBT_VECTOR_BOOL>(key, values[i].AsTypedVector());
-          break;
-
-          case FBT_VECTOR_KEY:  // for vector of strings
-            valid = map.setOrAdd<IsSet, FBT_VECTOR_KEY>(key, values[i].AsTypedVector());
-          break;
-
-          default:
-            PLOGE << __FUNCTION__ << " - unsupported type: " << values[i].GetType();
-            valid = false;
-          break;
-        }
+        const auto keyString = keys[i].AsString();
+        valid = map.setOrAdd<IsSet>(KeyView{std::string_view{keyString.c_str(), keyString.length()}}, values[i]);
       }
 
       return valid;
@@ -101,7 +216,77 @@ namespace fc
     template<bool IsSet>
     bool setOrAdd (const flexbuffers::TypedVector& keys, const flexbuffers::Vector& values)
     {
-      return setOrAdd<IsSet>(m_map, keys, values);
+      return setOrAdd<IsSet>(m_default.kv(), keys, values);
+    }
+
+
+    // For requests with a kv map which change each key then respond with a flexbuffer map, i.e. KVIncr, KVCas.
+    // update() is called for each key, and adds the key's result to the response map.
+    template<typename RequestT, typename CreateRspF, typename UpdateF>
+    void updateKeys (FlatBuilder& fbb, const RequestT& req, const fc::response::ResponseBody bodyType, CreateRspF createRsp, UpdateF update) noexcept
+    {
+      try
+      {
+        const auto& kv = req.kv_flexbuffer_root().AsMap();
+        const auto& keys = kv.Keys();
+        const auto& values = kv.Values();
+
+        CacheMap * map{nullptr};
+
+        if (const auto group = req.group(); group && !group->empty())
+          map = &(*getOrCreateGroup(group->str()))->second.kv();
+        else
+          map = &m_default.kv();
+
+        FlexBuilder flxb;
+        flxb.Map([&]
+        {
+          for (std::size_t i = 0 ; i < keys.size() ; ++i)
+          {
+            const auto keyString = keys[i].AsString();
+            update(*map, KeyView{std::string_view{keyString.c_str(), keyString.length()}}, keyString.c_str(), values[i], flxb);
+          }
+        });
+        flxb.Finish();
+
+        const auto vec = fbb.CreateVector(flxb.GetBuffer());
+        const auto body = createRsp(fbb, vec);
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, bodyType, body.Union());
+        fbb.Finish(rsp);
+      }
+      catch(const std::exception& e)
+      {
+        PLOGE << __FUNCTION__ << ":" << e.what();
+        createEmptyBodyResponse(fbb, Status_Fail, bodyType);
+      }
+    }
+
+
+    // KVIncr, KVDecr and KVAddFloat: the response has the new value of each key which add() changed
+    template<typename RequestT, typename CreateRspF, typename AddF>
+    void addNumeric (FlatBuilder& fbb, const RequestT& req, const fc::response::ResponseBody bodyType, CreateRspF createRsp, AddF add) noexcept
+    {
+      updateKeys(fbb, req, bodyType, createRsp, [&add](CacheMap& map, const KeyView& key, const char * keyString, const flexbuffers::Reference amount, FlexBuilder& flxb)
+      {
+        if (const FixedValue * value = add(map, key, amount); value)
+          value->extract(flxb, keyString, *value);
+      });
+    }
+
+
+    // True if a key in versions (key:version) doesn't have that version, where 0 is a key that doesn't exist
+    static bool changed (const CacheMap * map, const flexbuffers::Map& versions)
+    {
+      const auto keys = versions.Keys();
+      const auto values = versions.Values();
+
+      for (std::size_t i = 0 ; i < keys.size() ; ++i)
+      {
+        const auto current = map ? map->version(KeyView{keys[i].AsKey()}) : 0U;
+        if (current != values[i].AsUInt64())
+          return true;
+      }
+      return false;
     }
 
 
@@ -125,13 +310,58 @@ namespace fc
 
     GroupMap::iterator createGroup (const std::string& name)
     {
-      const auto it = m_groups.try_emplace(name, CacheMap{});
+      const auto it = m_groups.try_emplace(name);
       return it.first;
     }
 
 
+    // The group with an upload, or nullptr if the upload or its group no longer exist
+    Group * getUploadGroup (const std::uint64_t id)
+    {
+      if (const auto it = m_uploads.find(id); it == m_uploads.end())
+        return nullptr;
+      else if (it->second.group.empty())
+        return m_default.upload(id) ? &m_default : nullptr;
+      else if (const auto group = getGroup(it->second.group); group && (*group)->second.upload(id))
+        return &(*group)->second;
+      else
+        return nullptr;
+    }
+
+
   private:
-    CacheMap m_map;
+    struct UploadOwner
+    {
+      std::string group;      // empty for the default
+      std::uint64_t session;  // the connection which began the upload
+    };
+
+    // a group is compacted when reserved memory is at least this ratio of used memory ...
+    static constexpr double DefragRatio = 1.5;
+    // ... and wasted at least this many bytes ...
+    static constexpr std::size_t DefragMinWaste = 1024U * 1024U;
+    // ... and is not larger than this, which bounds the time spent compacting a group. Larger groups
+    // are reported in the metrics (defrag_skipped_groups), rather than stall the event loop
+    static constexpr std::size_t DefragMaxGroupBytes = 64U * 1024U * 1024U;
+    // max entries examined by a KVScan, which bounds the time spent and response size
+    static constexpr std::size_t ScanMaxCount = 10000U;
+    // max uploads in progress, which hold memory until committed, aborted or their connection closes
+    static constexpr std::size_t MaxUploads = 64U;
+    // max bytes returned by a KVChunkGet
+    static constexpr std::size_t ChunkMaxSize = 8U * 1024U * 1024U;
+    // max keys a group can be sized for when created, because the map's arrays are allocated immediately
+    static constexpr std::size_t GroupMaxReserve = 64U * 1024U * 1024U;
+
+    LazyFree& m_lazyFree;
+    WorkerPool& m_workers;
+    const std::size_t m_maxBlobSize;
+    Group m_default;  // keys not in a group
     GroupMap m_groups;
+    ankerl::unordered_dense::map<std::uint64_t, UploadOwner> m_uploads;
+    std::uint64_t m_nextUploadId{1};
+    std::uint64_t m_defragRuns{0};
+    std::uint64_t m_defragReleased{0};
+    std::size_t m_defragSkipped{0};       // at the most recent defrag(): fragmented groups too large to compact ...
+    std::size_t m_defragSkippedBytes{0};  // ... and their wasted bytes
   };
 }
\ No newline at end of file
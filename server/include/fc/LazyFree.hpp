@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fc/FlatBuffers.hpp>
+
+
+namespace fc
+{
+  // Destroys containers on a background thread, so that deleting or clearing
+  // large containers doesn't block the event loop.
+  //
+  // The caller moves the container into release(), which is O(1), and the 
+  // container's destructor is called on the LazyFree thread.
+  //
+  // Only containers which don't share a memory resource with the event loop thread
+  // can be released, i.e. a KV group's GroupMemory (each group has its own),
+  // or lists (global heap).
+  class LazyFree
+  {
+  public:
+    explicit LazyFree(const bool enabled);
+    ~LazyFree() = default;
+
+    LazyFree(const LazyFree&) = delete;
+    LazyFree& operator=(const LazyFree&) = delete;
+
+
+    // If enabled, obj is destroyed on the LazyFree thread, otherwise
+    // it is destroyed before this function returns.
+    template<typename T>
+    void release (T&& obj)
+    {
+      using ObjT = std::remove_cvref_t<T>;
+      
+      if (!m_enabled)
+      {
+        [[maybe_unused]] ObjT discard{std::move(obj)};
+      }
+      else
+      {
+        std::shared_ptr<void> item = std::make_shared<ObjT>(std::move(obj));
+        {
+          std::scoped_lock lock{m_mux};
+          m_pending.emplace_back(std::move(item));
+          ++m_queued;
+        }
+
+        m_cv.notify_one();
+      }
+    }
+
+    bool enabled() const noexcept { return m_enabled; }
+
+    void metrics (FlexBuilder& flxb) const;
+
+
+  private:
+    void run (std::stop_token stop);
+
+
+  private:
+    const bool m_enabled;
+    std::mutex m_mux;
+    std::condition_variable_any m_cv;
+    std::vector<std::shared_ptr<void>> m_pending;
+    std::atomic_uint64_t m_queued{0};
+    std::atomic_uint64_t m_freed{0};
+    std::atomic_uint64_t m_freeTimeUs{0};
+    std::jthread m_thread;  // last member: destroyed (stopped and joined) first
+  };
+}
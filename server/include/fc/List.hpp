@@ -113,6 +113,11 @@ namespace fc
     const List& list() const noexcept { return m_list; }
     bool isSorted () const noexcept { return m_sorted; }
 
+    // Changed whenever the list is modified, for conditional reads. Versions are unique across 
+    // lists, so a list which is deleted then recreated doesn't repeat a previous version.
+    std::uint64_t version() const noexcept { return m_version; }
+    void setVersion (const std::uint64_t version) noexcept { m_version = version; }
+
 
     bool canIntersectWith (const FcList& other)
     {
@@ -124,5 +129,6 @@ namespace fc
     const FlexType m_flexType;
     const fc::common::ListType m_listType;
     const bool m_sorted;
+    std::uint64_t m_version{0};
   };
 }
@@ -2,6 +2,7 @@
 
 #include <fc/FlatBuffers.hpp>
 #include <fc/ListOperations.hpp>
+#include <fc/LazyFree.hpp>
 #include <plog/Log.h>
 #include <map>
 #include <optional>
@@ -17,7 +18,9 @@ namespace fc
 
 
   public:
-    ListHandler() = default;
+    explicit ListHandler(LazyFree& lazyFree) : m_lazyFree(lazyFree)
+    {
+    }
 
 
   public:
@@ -54,6 +57,12 @@ namespace fc
     }
 
     
+    void modified (FcList& list) noexcept
+    {
+      list.setVersion(++m_version);
+    }
+
+    
     std::optional<Iterator> getList (const std::string& name)
     {
       if (auto it = m_lists.find(name) ; it != m_lists.end())
@@ -109,7 +118,9 @@ namespace fc
 
 
   private:
+    LazyFree& m_lazyFree;
     std::unordered_map<std::string, std::unique_ptr<FcList>> m_lists;
+    std::uint64_t m_version{0};   // last version given to a list
   };
 
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include <fc/FlatBuffers.hpp>
 #include <fc/Common.hpp>
 #include <fc/List.hpp>
+#include <fc/TypedVector.hpp>
+#include <vector>
 
 
 namespace fc
@@ -10,14 +12,27 @@ namespace fc
   template<typename Iterator>
   void listToTypedVector(FlexBuilder& flxb, Iterator it, const int64_t count)
   {
-    flxb.TypedVector([&flxb, it, count]() mutable
+    using value_type = typename std::iterator_traits<Iterator>::value_type;
+
+    if constexpr (std::is_arithmetic_v<value_type>)
+    {
+      // gather the list's nodes so the vector is written in bulk
+      std::vector<value_type> values;
+      values.reserve(count);
+      std::copy_n(it, count, std::back_inserter(values));
+      addTypedVector(flxb, nullptr, values.data(), values.size());
+    }
+    else
     {
-      for (int64_t i = 0 ; i < count ; ++i)
+      flxb.TypedVector([&flxb, it, count]() mutable
       {
-        flxb.Add(*it);
-        ++it;
-      }
-    });
+        for (int64_t i = 0 ; i < count ; ++i)
+        {
+          flxb.Add(*it);
+          ++it;
+        }
+      });
+    }
   }
 
 
@@ -79,6 +94,22 @@ namespace fc
 
 
 
+  // Converts items to a contiguous array, in bulk if possible
+  template<typename ValueT>
+  std::vector<ValueT> typedVectorToArray (const flexbuffers::TypedVector& items)
+  {
+    std::vector<ValueT> values(items.size());
+
+    if (!copyFromTypedVector<ValueT>(items, reinterpret_cast<std::uint8_t *>(values.data())))
+    {
+      for (std::size_t i = 0 ; i < items.size() ; ++i)
+        values[i] = items[i].As<ValueT>();
+    }
+
+    return values;
+  }
+
+
   // Add
   template<bool SortedList>
   struct Add
@@ -106,8 +137,16 @@ namespace fc
 
       if (append)
       {
-        for (std::size_t i = 0 ; i < items.size() ; ++i)
-          list.emplace_back(items[i].As<value_type>()); 
+        if constexpr (std::is_arithmetic_v<value_type>)
+        {
+          const auto values = typedVectorToArray<value_type>(items);
+          list.insert(list.end(), values.cbegin(), values.cend());
+        }
+        else
+        {
+          for (std::size_t i = 0 ; i < items.size() ; ++i)
+            list.emplace_back(items[i].As<value_type>()); 
+        }
       }
       else
         doAdd<value_type>(list);
@@ -146,10 +185,18 @@ namespace fc
 
         auto it = positionToStartIterator<iterator_t>(pos, list);
 
-        for (std::size_t i = 0 ; i < items.size() ; ++i)
+        if constexpr (std::is_arithmetic_v<ItemT>)
         {
-          it = list.emplace(it, items[i].As<ItemT>()); 
-          ++it;
+          const auto values = typedVectorToArray<ItemT>(items);
+          list.insert(it, values.cbegin(), values.cend());
+        }
+        else
+        {
+          for (std::size_t i = 0 ; i < items.size() ; ++i)
+          {
+            it = list.emplace(it, items[i].As<ItemT>()); 
+            ++it;
+          }
         }
       }
     }
@@ -477,10 +524,15 @@ namespace fc
   struct ListInfo
   {
     std::uint32_t size;
+    std::uint64_t memory;
   };
 
   struct Info
   {
+    // a std::list node is the value and the prev/next pointers
+    template<typename T>
+    static constexpr std::size_t NodeSize = sizeof(T) + 2*sizeof(void*);
+
     Info ()
     {
 
@@ -489,7 +541,24 @@ namespace fc
     template<typename ListT>
     ListInfo operator()(const ListT& list)
     {
-      return ListInfo{.size = static_cast<std::uint32_t>(std::size(list))};
+      using value_type = typename ListT::value_type;
+
+      const auto size = std::size(list);
+      std::uint64_t memory = size * NodeSize<value_type>;
+
+      if constexpr (std::is_same_v<value_type, fcstring>)
+      {
+        // strings beyond the small string buffer have a separate allocation
+        static const auto smallCapacity = fcstring{}.capacity();
+
+        for (const auto& s : list)
+        {
+          if (s.capacity() > smallCapacity)
+            memory += s.capacity() + 1;
+        }
+      }
+
+      return ListInfo{.size = static_cast<std::uint32_t>(size), .memory = memory};
     }
   };
 
@@ -1,24 +1,91 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <set>
+#include <span>
 #include <ankerl/unordered_dense.h>
+#include <fc/Aggregate.hpp>
+#include <fc/Bitmap.hpp>
+#include <fc/Hll.hpp>
 #include <fc/KvCommon.hpp>
+#include <fc/Similarity.hpp>
+#include <fc/TypedVector.hpp>
+#include <fc/WorkerPool.hpp>
 #include <plog/Log.h>
 
 
 namespace fc
 {
+  // Set when a group is created
+  struct MapOptions
+  {
+    bool ordered{false};    // maintain an ordered index of keys, for prefix and range queries
+    bool encoded{false};    // store string, blob and vector values as a finished flexbuffer (see setEncoded())
+    bool compressed{false}; // compress large string and blob values (see compressToMap())
+    std::size_t reserve{0}; // keys to size the map for when created, so it isn't rehashed while growing to this size
+  };
+
+
+  // A rehash happens when an insert exceeds the map's load factor. It reallocates the map's arrays
+  // and reinserts every key, which stalls the request (and all others) for large maps.
+  struct RehashStats
+  {
+    std::size_t count{0};
+    std::chrono::microseconds total{0};
+    std::chrono::microseconds max{0};
+  };
+
+
   class CacheMap
   {
-    using Map = ankerl::unordered_dense::pmr::map<std::string, CachedValue>;
+  #ifdef FC_SEGMENTED_MAP
+    // Entries are stored in fixed size segments, so growing doesn't reallocate and move every entry.
+    // The bucket array is still reallocated and rebuilt, so this only shortens the stall when a large
+    // map rehashes. Lookups have an extra indirection and each map allocates at least one segment (4KB),
+    // so it is a build option for deployments with large groups.
+    using Map = ankerl::unordered_dense::pmr::segmented_map<CachedKey, CachedValue, CachedKeyHash, CachedKeyEqual>;
+  #else
+    using Map = ankerl::unordered_dense::pmr::map<CachedKey, CachedValue, CachedKeyHash, CachedKeyEqual>;
+  #endif
     using CacheMapIterator = Map::iterator;
     using CacheMapConstIterator = Map::const_iterator;
+    // keys in order, viewing the CachedKey's characters, which don't move when the map's entries move
+    using OrderedIndex = std::pmr::set<std::string_view, std::less<>>;
     using enum FlexType;
 
 
+    // smaller values are unlikely to compress enough to be worthwhile
+    static constexpr std::size_t CompressMinSize = 256U;
+
   public:
-    CacheMap() : m_map(std::pmr::polymorphic_allocator {fc::MapMemory::getPool()})
+    explicit CacheMap(std::pmr::memory_resource * resource, const MapOptions& options = {}) :
+      m_map(std::pmr::polymorphic_allocator<>{resource}),
+      m_options(options)
+    {
+      if (m_options.ordered)
+        m_index.emplace(resource);
+
+      if (m_options.reserve)
+        m_map.reserve(m_options.reserve);
+    }
+
+    // Copies other's keys and values, allocating from resource
+    CacheMap(const CacheMap& other, std::pmr::memory_resource * resource) : CacheMap(resource, other.m_options)
     {
+      m_compressedBytes = other.m_compressedBytes;
+      m_uncompressedBytes = other.m_uncompressedBytes;
+      m_rehashStats = other.m_rehashStats;
+      m_map.reserve(std::max(other.m_map.size(), m_options.reserve));
 
+      for (const auto& kv : other.m_map)
+      {
+        const auto [it, _] = m_map.emplace(kv);
+        if (m_index)
+          m_index->emplace(it->first.view());
+      }
     }
 
     CacheMap& operator=(CacheMap&&) = default;
@@ -29,7 +96,7 @@ namespace fc
 
 
     template<bool IsSet, FlexType FlexT, typename ValueT>
-    bool setOrAdd (const CachedKey& key, const ValueT& value) noexcept requires (std::is_integral_v<ValueT> || std::is_same_v<ValueT, float>)
+    bool setOrAdd (const KeyView& key, const ValueT& value) noexcept requires (std::is_integral_v<ValueT> || std::is_same_v<ValueT, float>)
     {
       try
       {
@@ -49,13 +116,15 @@ namespace fc
         // set and add commands both emplace if does not exist
         if (const auto it = m_map.find(key) ; it == m_map.end())
         {
-          m_map.try_emplace(key, FixedValue{value, extract});
+          tryEmplace(key, FixedValue{value, extract});
         }
         else if constexpr (IsSet)
         {
           // but only set overwrites existing
+          released(it->second);
           it->second.value = FixedValue {value, extract};
           it->second.valueType = CachedValue::FIXED;
+          it->second.modified();
         }
         return true;
       }
@@ -69,7 +138,7 @@ namespace fc
 
 
     template<bool IsSet, FlexType FlexT>
-    bool setOrAdd (const CachedKey& key, const flexbuffers::TypedVector& v) noexcept
+    bool setOrAdd (const KeyView& key, const flexbuffers::TypedVector& v) noexcept
     {
       try
       {
@@ -80,9 +149,9 @@ namespace fc
         else if (IsSet)
         {
           // key already exists, so only replace value if it's a set command
-          it->second.valueType = CachedValue::VEC;
-          it->second.value = VectorValue{};
+          resetToVector(it->second);
           storeVectorValue<FlexT>(it, v);
+          it->second.modified();
         }
       }
       catch(const std::exception& e)
@@ -96,21 +165,20 @@ namespace fc
 
 
     template<bool IsSet>
-    bool setOrAdd (const CachedKey& key, const std::string_view str) noexcept
+    bool setOrAdd (const KeyView& key, const std::string_view str) noexcept
     {
       try
       {
         if (const auto it = m_map.find(key) ; it == m_map.end())
         {
-          auto [itEmplaced, _] = m_map.try_emplace(key, VectorValue{});
+          auto [itEmplaced, _] = tryEmplace(key, VectorValue{});
           stringToMap(itEmplaced, str);
         }
         else if (IsSet)
         {
-          it->second.valueType = CachedValue::VEC;
-          it->second.value = VectorValue{};
-
+          resetToVector(it->second);
           stringToMap(it, str);
+          it->second.modified();
         }
       }
       catch(const std::exception& e)
@@ -124,20 +192,20 @@ namespace fc
 
 
     template<bool IsSet>
-    bool setOrAdd (const CachedKey& key, const flexbuffers::Blob& blob)
+    bool setOrAdd (const KeyView& key, const flexbuffers::Blob& blob)
     {
       try
       {
         if (const auto it = m_map.find(key) ; it == m_map.end())
         {
-          auto [itEmplaced, _] = m_map.try_emplace(key, VectorValue{});
+          auto [itEmplaced, _] = tryEmplace(key, VectorValue{});
           blobToMap(itEmplaced, blob);
         }
         else if (IsSet)
         {
-          it->second.valueType = CachedValue::VEC;
-          it->second.value = VectorValue{};
+          resetToVector(it->second);
           blobToMap(it, blob);
+          it->second.modified();
         }
       }
       catch(const std::exception& e)
@@ -150,88 +218,241 @@ namespace fc
     }
 
 
-    inline void get (const KeyVector& keys, FlexBuilder& fb)
+    // A map value is stored as a HashValue, so its fields can be changed with setFields() and addFields()
+    template<bool IsSet>
+    bool setOrAdd (const KeyView& key, const flexbuffers::Map& fields) noexcept
     {
-      fb.Map([&]()
+      try
       {
-        for (const auto& key : keys)
-        { 
-          if (const auto& it = m_map.find(key->str()); it != m_map.cend())
-          {
-            const auto pKey = key->c_str();
-            const auto& cachedValue = it->second;
-
-            if (cachedValue.valueType == CachedValue::FIXED)
-            {
-              const auto& fixedValue = std::get<FixedValue>(cachedValue.value);
-              fixedValue.extract(fb, pKey, fixedValue);
-            }
-            else if (cachedValue.valueType == CachedValue::VEC)
-            {
-              const auto& vecValue = std::get<VectorValue>(cachedValue.value);
-              vecValue.extract(fb, pKey, vecValue);
-            }
-          }
-        }      
-      }); 
-    }
+        if (!isFieldMap(fields))
+        {
+          PLOGE << __FUNCTION__ << " - unsupported field type";
+          return false;
+        }
 
-    
-    // Get all keys in map
-    inline void get(FlexBuilder& fb)
-    {
-      fb.Map([&]
-      {
-        for (const auto& kv : m_map)
+        if (const auto it = m_map.find(key) ; it == m_map.end())
         {
-          const auto& cachedValue = kv.second;
-          const auto& key = kv.first;
-
-          if (cachedValue.valueType == CachedValue::FIXED)
-          {
-            const auto& fixedValue = std::get<FixedValue>(cachedValue.value);
-            fixedValue.extract(fb, key.c_str(), fixedValue);
-          }
-          else if (cachedValue.valueType == CachedValue::VEC)
-          {
-            const auto& vecValue = std::get<VectorValue>(cachedValue.value);
-            vecValue.extract(fb, key.c_str(), vecValue);
-          }
+          auto [itEmplaced, _] = tryEmplace(key, HashValue{});
+          writeFields(std::get<HashValue>(itEmplaced->second.value), fields);
         }
-      });
+        else if (IsSet)
+        {
+          writeFields(resetToHash(it->second), fields);
+          it->second.modified();
+        }
+      }
+      catch(const std::exception& e)
+      {
+        PLOGE << __FUNCTION__ << ":" << e.what();
+        return false;
+      }
+
+      return true;
     }
 
 
-    void remove (const KeyVector& keys)
+    // Sets or adds a value from a request, dispatching on the value's type
+    template<bool IsSet>
+    bool setOrAdd (const KeyView& key, const flexbuffers::Reference& value) noexcept
     {
-      for (const auto& key : keys)
-        m_map.erase(key->str());
-    };
+      if (m_options.encoded && (value.IsString() || value.IsBlob() || value.IsTypedVector()))
+        return setEncoded<IsSet>(key, value);
 
-    
-    bool clear() noexcept
+      switch (value.GetType())
+      {
+        case FBT_INT:
+          return setOrAdd<IsSet, FBT_INT>(key, value.AsInt64());
+        
+        case FBT_UINT:
+          return setOrAdd<IsSet, FBT_UINT>(key, value.AsUInt64());
+
+        case FBT_BOOL:
+          return setOrAdd<IsSet, FBT_BOOL>(key, value.AsBool());
+
+        case FBT_FLOAT:
+          return setOrAdd<IsSet, FBT_FLOAT>(key, value.AsFloat());
+
+        case FBT_STRING:
+          return setOrAdd<IsSet>(key, value.AsString().c_str());
+
+        case FBT_BLOB:
+          return setOrAdd<IsSet>(key, value.AsBlob());
+
+        case FBT_VECTOR_INT:
+          return setOrAdd<IsSet, FBT_VECTOR_INT>(key, value.AsTypedVector());
+
+        case FBT_VECTOR_UINT:
+          return setOrAdd<IsSet, FBT_VECTOR_UINT>(key, value.AsTypedVector());
+
+        case FBT_VECTOR_FLOAT:
+          return setOrAdd<IsSet, FBT_VECTOR_FLOAT>(key, value.AsTypedVector());
+
+        case FBT_VECTOR_BOOL:
+          return setOrAdd<IsSet, FBT_VECTOR_BOOL>(key, value.AsTypedVector());
+
+        case FBT_VECTOR_KEY:  // for vector of strings
+          return setOrAdd<IsSet, FBT_VECTOR_KEY>(key, value.AsTypedVector());
+
+        case FBT_MAP:
+          return setOrAdd<IsSet>(key, value.AsMap());
+
+        default:
+          PLOGE << __FUNCTION__ << " - unsupported type: " << value.GetType();
+          return false;
+      }
+    }
+
+
+    // The bytes of a blob value, or nothing if the key doesn't exist or is not a blob. Invalid after the map changes.
+    std::optional<std::span<const std::uint8_t>> blob (const KeyView& key) const noexcept;
+
+
+    // Sets key to a blob value, with data as blobToMap() stores it. The value must be allocated from
+    // this map's memory, so it is moved rather than copied.
+    void setBlob (const KeyView& key, VectorValue&& value)
     {
-      try
+      value.type = FBT_BLOB;
+      value.extract = extractBlob;
+
+      // try_emplace() doesn't move from value if the key exists
+      if (auto [it, created] = tryEmplace(key, std::move(value)); !created)
       {
-        m_map.clear();//replace(Map::value_container_type{});
-        PLOGD << __FUNCTION__ << ":" << m_map.size();
-        return true;
+        resetToVector(it->second) = std::move(value);
+        it->second.modified();
       }
-      catch (const std::exception& ex)
+    }
+
+
+    // Appends to a string, blob or vector value in place. If the key doesn't exist, it is set.
+    // Returns the value's new size: bytes for a string or blob, otherwise elements.
+    // Returns nothing if the value can't be appended to the existing value, the existing value is a
+    // HyperLogLog, or a string or blob would be larger than maxSize bytes.
+    std::optional<std::size_t> append (const KeyView& key, const flexbuffers::Reference& value, const std::size_t maxSize);
+
+    // Overwrites part of a string, blob or vector value in place, starting at offset (bytes for a
+    // string or blob, otherwise elements), growing the value if required. The offset can't be
+    // beyond the end of the existing value. If the key doesn't exist, offset must be 0.
+    // Returns as append().
+    std::optional<std::size_t> writeAt (const KeyView& key, const std::size_t offset, const flexbuffers::Reference& value, const std::size_t maxSize);
+
+
+    inline void get (const KeyVector& keys, FlexBuilder& fb) const
+    {
+      fb.Map([&]{ getKeys(keys, fb); });
+    }
+
+    // As get(), but the map is added with mapKey to a map being built by fb
+    inline void get (const char * mapKey, const KeyVector& keys, FlexBuilder& fb) const
+    {
+      fb.Map(mapKey, [&]{ getKeys(keys, fb); });
+    }
+
+    
+    // As get(), but a key in slices is a [start, stop) range of the value: bytes of a string or blob, 
+    // otherwise elements. The range is the same as ListGetRange: start and stop can be negative
+    // and if stop is not set, the range is to the end. Keys not in slices, and fixed values, are returned whole.
+    void get (const KeyVector& keys, FlexBuilder& fb, const flexbuffers::Map& slices) const;
+
+    // The size of each key's value: bytes for a string or blob, elements of a vector, fields of a hash, otherwise 1
+    void sizes (const KeyVector& keys, FlexBuilder& fb) const;
+    void sizes (FlexBuilder& fb) const;
+
+    // Each int, uint and float vector value reduced to a scalar, as key:result. 
+    // Other value types, including vectors in an encoded group, are skipped.
+    void aggregate (const KeyVector& keys, const Aggregation& agg, FlexBuilder& fb) const;
+    void aggregate (const Aggregation& agg, FlexBuilder& fb) const;
+
+    // Each key's metadata, read without serialising the value, as key:{type, size, bytes, version}.
+    // type is the FlexType, size is as sizes() and bytes is the value's stored size, which is compressed if 
+    // the group is compressed
+    void info (const KeyVector& keys, FlexBuilder& fb) const;
+    void info (FlexBuilder& fb) const;
+
+
+    // Get all keys in map
+    inline void get(FlexBuilder& fb) const
+    {
+      fb.Map([&]{ getAll(fb); });
+    }
+
+    inline void get(const char * mapKey, FlexBuilder& fb) const
+    {
+      fb.Map(mapKey, [&]{ getAll(fb); });
+    }
+
+
+    // Serialises entries from the cursor, which is an index in the map's value array, examining at most count entries.
+    // If pattern isn't empty, only keys matching the glob are serialised. Returns the next cursor, or 0 when complete.
+    // An erase moves the last entry into the erased entry's position, so keys erased during a scan can cause other keys
+    // to be missed.
+    std::uint64_t scan (FlexBuilder& fb, const std::uint64_t cursor, const std::size_t count, const std::string_view pattern, const bool keysOnly) const;
+
+
+    void remove (const KeyVector& keys)
+    {
+      for (const auto& key : keys)
       {
-        PLOGE << ex.what();
-        return false;
+        if (const auto it = m_map.find(KeyView{key->string_view()}); it != m_map.end())
+        {
+          released(it->second);
+
+          if (m_index)
+            m_index->erase(it->first.view());
+
+          m_map.erase(it);
+        }
       }
     };
 
 
+    bool isOrdered() const noexcept
+    {
+      return m_index.has_value();
+    }
+
+    bool isEncoded() const noexcept
+    {
+      return m_options.encoded;
+    }
+
+    bool isCompressed() const noexcept
+    {
+      return m_options.compressed;
+    }
+
+    // Bytes of compressed values, as stored
+    std::size_t compressedBytes() const noexcept
+    {
+      return m_compressedBytes;
+    }
+
+    // Bytes of compressed values, uncompressed
+    std::size_t uncompressedBytes() const noexcept
+    {
+      return m_uncompressedBytes;
+    }
+
+    const RehashStats& rehashStats() const noexcept
+    {
+      return m_rehashStats;
+    }
+
+    // Keys which start with prefix, in order, with their values unless keysOnly. A limit of 0 is no limit.
+    // Requires the map is ordered.
+    void getPrefix (FlexBuilder& fb, const std::string_view prefix, const bool keysOnly, const std::size_t limit) const;
+
+    // Keys in [start, end), in order. If end is empty, keys from start to the last key. A limit of 0 is no limit.
+    // Requires the map is ordered.
+    void rangeKeys (FlexBuilder& fb, const std::string_view start, const std::string_view end, const std::size_t limit) const;
+
+
     void contains (FlexBuilder& fb, const KeyVector& keys) const
     {
       fb.TypedVector([&keys, &fb, this]()
       {
         for (const auto key : keys)
         {
-          if (m_map.contains(key->str()))
+          if (m_map.contains(KeyView{key->string_view()}))
             fb.String(key->c_str());
         }
       });      
@@ -244,7 +465,193 @@ namespace fc
     }
 
 
+    // The key's version, or 0 if the key does not exist
+    std::uint64_t version (const KeyView& key) const noexcept
+    {
+      if (const auto it = m_map.find(key); it == m_map.cend())
+        return 0;
+      else
+        return it->second.version;
+    }
+
+
+    void versions (const KeyVector& keys, FlexBuilder& fb) const
+    {
+      fb.Map([&]
+      {
+        for (const auto& key : keys)
+        {
+          if (const auto it = m_map.find(KeyView{key->string_view()}); it != m_map.cend())
+            fb.UInt(key->c_str(), it->second.version);
+        }
+      });
+    }
+
+
+    // Versions of all keys in map
+    void versions (FlexBuilder& fb) const
+    {
+      fb.Map([&]
+      {
+        for (const auto& kv : m_map)
+          fb.UInt(kv.first.c_str(), kv.second.version);
+      });
+    }
+
+
+    // Adds delta to an fcint or fcuint value in place, saturating rather than overflowing.
+    // If the key doesn't exist, it is created as an fcint with value delta.
+    // Returns nullptr if the existing value is not an integer.
+    const FixedValue * addInt (const KeyView& key, const fcint delta)
+    {
+      auto [it, created] = tryEmplace(key, FixedValue{delta, extractInt});
+
+      if (created)
+        return &std::get<FixedValue>(it->second.value);
+      else if (it->second.valueType != CachedValue::FIXED)
+        return nullptr;
+
+      auto& fixed = std::get<FixedValue>(it->second.value);
+
+      if (auto pInt = std::get_if<fcint>(&fixed.value); pInt)
+        *pInt = saturatingAdd(*pInt, delta);
+      else if (auto pUInt = std::get_if<fcuint>(&fixed.value); pUInt)
+        *pUInt = saturatingAdd(*pUInt, delta);
+      else
+        return nullptr;
+
+      it->second.modified();
+      return &fixed;
+    }
+
+
+    // Adds delta to an fcfloat value in place. If the key doesn't exist, it is created with value delta.
+    // Returns nullptr if the existing value is not a float.
+    const FixedValue * addFloat (const KeyView& key, const fcfloat delta)
+    {
+      auto [it, created] = tryEmplace(key, FixedValue{delta, extractFloat});
+
+      if (created)
+        return &std::get<FixedValue>(it->second.value);
+      else if (it->second.valueType != CachedValue::FIXED)
+        return nullptr;
+
+      auto& fixed = std::get<FixedValue>(it->second.value);
+
+      if (auto pFloat = std::get_if<fcfloat>(&fixed.value); pFloat)
+      {
+        *pFloat += delta;
+        it->second.modified();
+        return &fixed;
+      }
+      else
+        return nullptr;
+    }
+
+
+    // Sets fields of a hash value, which is created if the key doesn't exist, leaving other fields unchanged.
+    // A field's value must be an int, uint, float, bool or string. Only the fields set are written, so the cost
+    // is proportional to the fields rather than the whole value.
+    // Returns false, without changing the hash, if the key isn't a hash or a value's type isn't supported.
+    bool setFields (const KeyView& key, const flexbuffers::Map& fields);
+
+    // Adds each amount (field:amount) to an int, uint or float field, saturating ints as addInt(). The hash and 
+    // fields are created as required, where a new field is the amount. The new values are added to fb as field:value.
+    // Returns false, without changing the hash, if the key isn't a hash, or a field or amount isn't numeric.
+    bool addFields (const KeyView& key, const flexbuffers::Map& amounts, FlexBuilder& fb);
+
+    // The key's hash value, or nullptr if the key doesn't exist or isn't a hash. Invalid after the map changes.
+    const HashValue * hash (const KeyView& key) const noexcept
+    {
+      if (const auto it = m_map.find(key); it == m_map.cend() || it->second.valueType != CachedValue::HASH)
+        return nullptr;
+      else
+        return &std::get<HashValue>(it->second.value);
+    }
+
+    // Adds the hash's fields to fb as field:value, or only those in names if not null. Fields which don't exist are skipped.
+    static void getFields (FlexBuilder& fb, const HashValue& hash, const KeyVector * names);
+
+
+    // A bitmap is a blob value (see Bitmap.hpp), so blob() gets a bitmap to test or count bits.
+    // Bitmaps can't be changed in an encoded map, because its blobs are encoded.
+
+    // Sets or clears bits, creating the blob if the key doesn't exist, and growing it with zero bytes to fit the highest bit.
+    // Returns the number of bits changed, or nothing if the value isn't a blob, is compressed or a HyperLogLog, the map
+    // is encoded, or a bit is >= bitmap::MaxBits.
+    std::optional<std::uint64_t> setBits (const KeyView& key, const flatbuffers::Vector<std::uint64_t>& bits, const bool value);
+
+    // Replaces dest's value with a bitmap of op over the bitmaps of keys, where a key that doesn't exist is an
+    // empty bitmap. The result is the size of the largest bitmap. Returns the number of bits set in the result, 
+    // or nothing if a key's value isn't a bitmap, dest or a key is a HyperLogLog, or the map is encoded.
+    std::optional<std::uint64_t> bitOp (const fc::request::BitOp op, const KeyView& dest, const KeyVector& keys);
+
+
+    // A HyperLogLog is a blob value (see Hll.hpp). As bitmaps, they can't be changed in an encoded map.
+
+    // The HyperLogLog of key, or nothing if the key doesn't exist or isn't a HyperLogLog.
+    std::optional<std::span<const std::uint8_t>> hll (const KeyView& key) const noexcept
+    {
+      if (const auto bytes = blob(key); bytes && hll::isHll(*bytes))
+        return bytes;
+      else
+        return {};
+    }
+
+    // Adds items, creating the HyperLogLog if the key doesn't exist. Returns if a register changed,
+    // or nothing if the value isn't a HyperLogLog or the map is encoded.
+    std::optional<bool> hllAdd (const KeyView& key, const KeyVector& items);
+
+    // Estimated unique items in the union of keys, where a key that doesn't exist is empty.
+    // Returns nothing if a key's value isn't a HyperLogLog.
+    std::optional<std::uint64_t> hllCount (const KeyVector& keys) const;
+
+    // Replaces dest's value with the union of keys. Returns the estimated unique items of the
+    // result, or nothing if a key's value isn't a HyperLogLog or the map is encoded.
+    std::optional<std::uint64_t> hllMerge (const KeyView& dest, const KeyVector& keys);
+
+
+    // The k float vector values most similar to query, of values with the same number of elements. Encoded values
+    // are skipped. A large map is split into shards, each scanned on one of the workers, up to threads shards.
+    // Returns key:score, most similar first. The keys are invalid after the map changes.
+    std::vector<std::pair<std::string_view, float>> nearest (const std::span<const float> query, const fc::request::Metric metric,
+                                                             const std::size_t k, const std::size_t threads, WorkerPool& workers) const;
+
+
   private:
+    static void extract (FlexBuilder& fb, const char * key, const CachedValue& cachedValue)
+    {
+      if (cachedValue.valueType == CachedValue::FIXED)
+      {
+        const auto& fixedValue = std::get<FixedValue>(cachedValue.value);
+        fixedValue.extract(fb, key, fixedValue);
+      }
+      else if (cachedValue.valueType == CachedValue::VEC)
+      {
+        const auto& vecValue = std::get<VectorValue>(cachedValue.value);
+        vecValue.extract(fb, key, vecValue);
+      }
+      else if (cachedValue.valueType == CachedValue::HASH)
+      {
+        fb.Map(key, [&]{ getFields(fb, std::get<HashValue>(cachedValue.value), nullptr); });
+      }
+    }
+
+    void getKeys (const KeyVector& keys, FlexBuilder& fb) const
+    {
+      for (const auto& key : keys)
+      { 
+        if (const auto& it = m_map.find(KeyView{key->string_view()}); it != m_map.cend())
+          extract(fb, key->c_str(), it->second);
+      }
+    }
+
+    void getAll (FlexBuilder& fb) const
+    {
+      for (const auto& [key, cachedValue] : m_map)
+        extract(fb, key.c_str(), cachedValue);
+    }
+
 
     static void extractInt(FlexBuilder& fb, const char * key, const FixedValue& fv);
     static void extractUInt(FlexBuilder& fb, const char * key, const FixedValue& fv);
@@ -257,14 +664,132 @@ namespace fc
     static void extractFloatV(FlexBuilder& fb, const char * key, const VectorValue& vv);
     static void extractBoolV(FlexBuilder& fb, const char * key, const VectorValue& vv);
     static void extractString(FlexBuilder& fb, const char * key, const VectorValue& vv);
+    static void extractSlice(FlexBuilder& fb, const char * key, const VectorValue& vv, const flexbuffers::Reference& slice);
+    static void extractEncoded(FlexBuilder& fb, const char * key, const VectorValue& vv);
+
+    static bool isEncodedValue (const VectorValue& vv) noexcept
+    {
+      return vv.extract == extractEncoded;
+    }
+
+    static void extractCompressed(FlexBuilder& fb, const char * key, const VectorValue& vv);
+
+    static bool isCompressedValue (const VectorValue& vv) noexcept
+    {
+      return vv.extract == extractCompressed;
+    }
     
 
+    // Size of a string, blob or vector value: bytes for a string or blob, otherwise elements
+    static std::size_t valueSize (const VectorValue& vec) noexcept;
+
+    // As sizes(): valueSize() of a vector, fields of a hash, otherwise 1
+    static std::size_t valueSize (const CachedValue& cv) noexcept;
+
+    // A HyperLogLog is a blob, but only hllAdd() and hllMerge() can change it, so it's
+    // not a bitmap and can't be appended to or written to
+    static bool isHllValue (const VectorValue& vec) noexcept
+    {
+      return vec.type == FBT_BLOB && !isEncodedValue(vec) && !isCompressedValue(vec) &&
+             hll::isHll(std::span<const std::uint8_t>{vec.data.data() + sizeof(fcblobsize), valueSize(vec)});
+    }
+
+    static void aggregateValue (FlexBuilder& fb, const char * key, const CachedValue& cv, const Aggregation& agg);
+
+    static void valueInfo (FlexBuilder& fb, const char * key, const CachedValue& cv);
+
+    // Merges the HyperLogLogs of keys into registers. False if a key's value isn't a HyperLogLog
+    bool hllRegisters (const KeyVector& keys, hll::Registers& registers) const;
+
+    // Values in [begin, end) of m_map.values(), so shards can be scanned concurrently
+    template<fc::request::Metric M>
+    void nearestScan (const std::span<const float> query, const float queryNorm, const std::size_t begin, const std::size_t end,
+                      similarity::TopK& topK) const noexcept;
+
+    // True if each value is a type a hash field can store
+    static bool isFieldMap (const flexbuffers::Map& fields) noexcept;
+    static void writeFields (HashValue& hash, const flexbuffers::Map& fields);
+    static void writeField (HashField& field, const flexbuffers::Reference& value);
+    static void addField (FlexBuilder& fb, const char * name, const HashField::Value& value);
+
+    // The value types which can be appended to or written to vec
+    static bool isCompatible (const VectorValue& vec, const FlexType incoming) noexcept;
+
+    // True if writing value at offset would make a string or blob larger than maxSize, or than its size header allows
+    static bool exceedsMaxSize (const VectorValue& vec, const std::size_t offset, const flexbuffers::Reference& value, const std::size_t maxSize) noexcept;
+
+    static void write (VectorValue& vec, const std::size_t offset, const flexbuffers::Reference& value);
+    static void writeBytes (VectorValue& vec, const std::size_t offset, const void * src, const std::size_t size);
+    static void writeStrings (VectorValue& vec, const std::size_t index, const flexbuffers::TypedVector& strings);
+
+    template<typename ScalarT>
+    static void writeScalars (VectorValue& vec, const std::size_t index, const flexbuffers::TypedVector& v)
+    {
+      const auto required = (index + v.size()) * sizeof(ScalarT);
+
+      if (required > vec.data.size())
+        vec.data.resize(required);
+
+      if (copyFromTypedVector<ScalarT>(v, vec.data.data() + index*sizeof(ScalarT)))
+        return;
+
+      for (std::size_t i = 0 ; i < v.size() ; ++i)
+      {
+        const auto val = v[i].As<ScalarT>();
+        std::memcpy(vec.data.data() + (index+i)*sizeof(ScalarT), &val, sizeof(ScalarT));
+      }
+    }
+
+
+    static fcint saturatingAdd (const fcint value, const fcint delta) noexcept
+    {
+      if (fcint result; __builtin_add_overflow(value, delta, &result))
+        return delta > 0 ? std::numeric_limits<fcint>::max() : std::numeric_limits<fcint>::min();
+      else
+        return result;
+    }
+
+    static fcuint saturatingAdd (const fcuint value, const fcint delta) noexcept
+    {
+      if (delta >= 0)
+      {
+        fcuint result;
+        return __builtin_add_overflow(value, static_cast<fcuint>(delta), &result) ? std::numeric_limits<fcuint>::max() : result;
+      }
+      else
+      {
+        // -(delta+1) avoids overflow when delta is min()
+        const fcuint magnitude = static_cast<fcuint>(-(delta + 1)) + 1U;
+        return value > magnitude ? value - magnitude : 0U;
+      }
+    }
+
+
+    // Replaces the value with an empty VectorValue. This must be used rather than assigning
+    // a VectorValue{} because that would allocate from the default resource, not the group's memory.
+    VectorValue& resetToVector (CachedValue& cv)
+    {
+      released(cv);
+      cv.valueType = CachedValue::VEC;
+      return cv.value.emplace<VectorValue>(VectorValue::allocator_type{m_map.get_allocator().resource()});
+    }
+
+
+    // As resetToVector(), for a hash
+    HashValue& resetToHash (CachedValue& cv)
+    {
+      released(cv);
+      cv.valueType = CachedValue::HASH;
+      return cv.value.emplace<HashValue>(HashValue::allocator_type{m_map.get_allocator().resource()});
+    }
+
+
     template<FlexType FlexT>
-    void storeVectorValue (const std::string& key, const flexbuffers::TypedVector& v)
+    void storeVectorValue (const KeyView& key, const flexbuffers::TypedVector& v)
     {
       // this function is only called if the key is not in the map, so
       // no need to check second return value of try_emplace()
-      auto [it, _] = m_map.try_emplace(key, VectorValue{});
+      auto [it, _] = tryEmplace(key, VectorValue{});
       storeVectorValue<FlexT>(it, v);
     }
 
@@ -296,6 +821,9 @@ namespace fc
       vec.extract = extract;
       vec.data.resize(size);
 
+      if (copyFromTypedVector<ScalarT>(v, vec.data.data()))
+        return;
+
       for (std::size_t i = 0, j = 0 ; i < v.size() ; ++i)
       {
         const auto val = v[i].As<ScalarT>();
@@ -337,6 +865,9 @@ namespace fc
 
     void stringToMap(const Map::iterator it, const std::string_view& str)
     {
+      if (m_options.compressed && str.size() >= CompressMinSize && compressToMap(it, FBT_STRING, str.data(), str.size()))
+        return;
+
       const std::size_t totalLength = str.size() + 1; // +1 for '\0'
       
       auto& vec = std::get<CachedValue::VEC>(it->second.value);
@@ -355,6 +886,9 @@ namespace fc
       // [blob_len][blob_data]
       // where blob_len is fcblobsize (uint32_t)
 
+      if (m_options.compressed && blob.size() >= CompressMinSize && compressToMap(it, FBT_BLOB, blob.data(), blob.size()))
+        return;
+
       const fcblobsize blobSize = static_cast<fcblobsize>(blob.size());
       const auto bufferSize = blobSize + sizeof(fcblobsize);
       
@@ -370,8 +904,108 @@ namespace fc
     }
 
 
+    // In an encoded map, a string, blob or vector value is stored as a finished flexbuffer with the value as its root,
+    // so a get copies the buffer as a blob rather than serialising each element. The client decodes the blob.
+    // vec.type is the type of the root. An encoded value can't be appended to, written to or sliced.
+    template<bool IsSet>
+    bool setEncoded (const KeyView& key, const flexbuffers::Reference& value) noexcept
+    {
+      try
+      {
+        if (const auto it = m_map.find(key) ; it == m_map.end())
+        {
+          auto [itEmplaced, _] = tryEmplace(key, VectorValue{});
+          encodedToMap(itEmplaced, value);
+        }
+        else if (IsSet)
+        {
+          resetToVector(it->second);
+          encodedToMap(it, value);
+          it->second.modified();
+        }
+      }
+      catch(const std::exception& e)
+      {
+        PLOGE << __FUNCTION__ << ":" << e.what();
+        return false;
+      }
+
+      return true;
+    }
+
+    void encodedToMap (const Map::iterator it, const flexbuffers::Reference& value);
+
+
+    // In a compressed map, a string or blob of at least CompressMinSize bytes is compressed with zlib, if that makes it smaller:
+    //  [uncompressed size][compressed bytes]
+    // where uncompressed size is fcblobsize. vec.type is the value's type. It is decompressed by a get, but can't
+    // be appended to, written to, or sliced. Returns false if not compressed, so the value should be stored as normal.
+    bool compressToMap (const Map::iterator it, const FlexType type, const void * data, const std::size_t size);
+
+    // Called before a value is replaced or removed
+    void released (const CachedValue& cv) noexcept
+    {
+      if (cv.valueType == CachedValue::VEC)
+      {
+        if (const auto& vec = std::get<VectorValue>(cv.value); isCompressedValue(vec))
+        {
+          m_compressedBytes -= vec.data.size();
+          m_uncompressedBytes -= valueSize(vec);
+        }
+      }
+    }
+
+
+    // All inserts use this so the ordered index is maintained
+    template<typename ValueT>
+    std::pair<Map::iterator, bool> tryEmplace (const KeyView& key, ValueT&& value)
+    {
+      // only timed when this insert may rehash, which is rare
+      const auto buckets = m_map.bucket_count();
+      const bool mayRehash = buckets && m_map.size() + 1 >= static_cast<std::size_t>(m_map.max_load_factor() * buckets);
+      const auto start = mayRehash ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
+      auto result = m_map.try_emplace(key, std::forward<ValueT>(value));
+
+      if (mayRehash && m_map.bucket_count() != buckets)
+        rehashed(std::chrono::steady_clock::now() - start);
+
+      if (result.second && m_index)
+      {
+        try
+        {
+          m_index->emplace(result.first->first.view());
+        }
+        catch (...)
+        {
+          m_map.erase(result.first);
+          throw;
+        }
+      }
+      
+      return result;
+    }
+
+
+    void rehashed (const std::chrono::steady_clock::duration duration) noexcept
+    {
+      const auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration);
+
+      ++m_rehashStats.count;
+      m_rehashStats.total += us;
+      m_rehashStats.max = std::max(m_rehashStats.max, us);
+
+      PLOGD << "Rehashed to " << m_map.bucket_count() << " buckets in " << us.count() << "us";
+    }
+
+
   private:
     Map m_map;
+    std::optional<OrderedIndex> m_index;
+    MapOptions m_options;
+    std::size_t m_compressedBytes{0};
+    std::size_t m_uncompressedBytes{0};
+    RehashStats m_rehashStats;
   };
 
 }
\ No newline at end of file
@@ -1,9 +1,14 @@
 #pragma once
 
 #include <memory_resource>
+#include <cassert>
+#include <array>
+#include <filesystem>
 #include <functional>
 #include <plog/Log.h>
 #include <format>
+#include <optional>
+#include <bit>
 #include <fc/Common.hpp>
 
 namespace fc
@@ -13,6 +18,8 @@ namespace fc
   ///   - a mononotic resource only releases memory when the resource is destroyed
   ///   - but that's ok because the pool tracks unused memory (free list) within the buffer allocated by the monotonic
   ///   - when a value is erased, the free list is aware and can reuse it
+  ///   - except allocations larger than the pool's largest block, which the pool passes directly to its upstream,
+  ///     so these bypass the pool and monotonic (see LargeBlockResource), otherwise they'd never be freed
   ///
   /// This has been influenced by Jason Turner's video:
   ///   https://www.youtube.com/watch?v=Zt0q3OEeuB0&list=PLs3KjaCtOwSYX3X0L36NgwK0pxZZavDSF&index=5&t=265
@@ -128,136 +135,246 @@ namespace fc
 
   
 
-  // This contains the resources used by the cache map (ankerl::unordered_dense::map).
-  // The key (std::pmr::string) and value (CachedValue) are placed in pooled memory.
-  // If the CachedValue contains a VectorValue, it uses the VectorMemory below.
-  class MapMemory
+  // Options for a group's memory. The defaults apply to all groups, and can be set
+  // on the command line.
+  struct MemoryOptions
   {
-  private:
-    #ifdef FC_DEBUG
-      MapMemory() : m_mapFixedResource(1024),
-                    m_mapFixedPrint("Map Mono", &m_mapFixedResource),
-                    m_mapPoolResource(&m_mapFixedPrint),
-                    m_mapPoolPrint("Map Pool", &m_mapPoolResource)
-      {
-      }
-    #else
-      MapMemory() : m_mapFixedResource(1024),
-                    m_mapPoolResource(&m_mapFixedResource)
-      {
-      }
-    #endif
+    std::pmr::pool_options pool{};
+    std::size_t initialSize{1024};  // size of the monotonic resource's first buffer
+
+    static MemoryOptions& defaults() noexcept
+    {
+      static MemoryOptions options;
+      return options;
+    }
+  };
 
 
+  // Records allocation sizes requested from the groups' pools, in power of two buckets.
+  // The histogram is saved at shutdown, and can be loaded at startup to derive 
+  // pool options suited to the sizes of keys and values actually stored.
+  class AllocHistogram
+  {
   public:
-    ~MapMemory() = default;
+    static constexpr std::size_t Buckets = 48;
 
-    static std::pmr::memory_resource * getPool() noexcept
+    static AllocHistogram& get() noexcept
     {
-      return get().pool();
+      static AllocHistogram histogram;
+      return histogram;
     }
 
+    void enable() noexcept { m_enabled = true; }
+    bool enabled() const noexcept { return m_enabled; }
+
+    // bucket N contains sizes in the range (2^(N-1), 2^N]
+    void record(const std::size_t bytes) noexcept
+    {
+      if (m_enabled)
+        ++m_counts[std::min<std::size_t>(std::bit_width(bytes ? bytes-1 : 0), Buckets-1)];
+    }
+
+    bool load(const std::filesystem::path& path);
+    bool save(const std::filesystem::path& path) const;
+
+    // largest_required_pool_block covers 99% of allocations.
+    // max_blocks_per_chunk is set so that a chunk of the most common size is about 64KB.
+    std::optional<std::pmr::pool_options> deriveOptions() const;
+
   private:
+    std::array<std::uint64_t, Buckets> m_counts{};
+    bool m_enabled{false};
+  };
+
+
+  // Allocate and touch bytes so the pages are resident, then free. The memory remains in the
+  // heap for subsequent allocations, without changing malloc's thresholds for the process,
+  // until malloc_trim() returns it to the OS (i.e. when defrag runs).
+  bool prefault(const std::size_t bytes);
 
-    static MapMemory& get()
+
+  // Passes requests to upstream, tracking how many bytes are currently allocated through it.
+  class CountingResource : public std::pmr::memory_resource
+  {
+  public:
+    explicit CountingResource(std::pmr::memory_resource * upstream, const bool recordSizes = false) :
+      m_upstream(upstream),
+      m_recordSizes(recordSizes)
     {
-      static MapMemory mem;
-      return mem;
+      assert(upstream);
     }
-    
 
-    std::pmr::memory_resource * pool() noexcept
+    std::size_t bytes() const noexcept { return m_bytes; }
+
+
+  private:
+    void * do_allocate(std::size_t bytes, std::size_t alignment) override
     {
-      #ifdef FC_DEBUG
-        return &m_mapPoolPrint; 
-      #else
-        return &m_mapPoolResource;     
-      #endif
+      auto result = m_upstream->allocate(bytes, alignment);
+      m_bytes += bytes;
+
+      if (m_recordSizes)
+        AllocHistogram::get().record(bytes);
+
+      return result;
     }
 
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+      m_upstream->deallocate(p, bytes, alignment);
+      m_bytes -= bytes;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+      return this == &other;
+    }
 
   private:
-    #ifdef FC_DEBUG
-      std::pmr::monotonic_buffer_resource m_mapFixedResource;
-      PrintResource m_mapFixedPrint;
-      std::pmr::unsynchronized_pool_resource m_mapPoolResource;
-      PrintResource m_mapPoolPrint;
-    #else
-      std::pmr::monotonic_buffer_resource m_mapFixedResource;
-      std::pmr::unsynchronized_pool_resource m_mapPoolResource;
-    #endif
+    std::pmr::memory_resource * m_upstream;
+    std::size_t m_bytes{0};
+    const bool m_recordSizes;
   };
 
 
-  // This pool is used by VectorValue to store vectors of scalars types,
-  // and also strings (treated as a vector chars).
-  class VectorMemory
+
+  // Passes allocations larger than threshold to large, others to small.
+  //
+  // The pool passes allocations larger than its largest block to its upstream. When that is the monotonic
+  // resource, deallocating is a no-op, so replacing, appending to or removing a large value would leak the
+  // previous buffer until the group is cleared. Large allocations are instead sent to a resource which frees.
+  class LargeBlockResource : public std::pmr::memory_resource
   {
+  public:
+    LargeBlockResource(std::pmr::memory_resource * small, std::pmr::memory_resource * large, const std::size_t threshold) :
+      m_small(small),
+      m_large(large),
+      m_threshold(threshold)
+    {
+      assert(small && large);
+    }
+
+    // bytes currently allocated from large
+    std::size_t largeBytes() const noexcept { return m_largeBytes; }
+
+
   private:
-    // TODO std::pmr::pool_options, see if there are optimisations for larger chunk sizes,
-    //      particularly with blobs which will likely be a factor larger
+    void * do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+      if (bytes <= m_threshold)
+        return m_small->allocate(bytes, alignment);
+
+      auto result = m_large->allocate(bytes, alignment);
+      m_largeBytes += bytes;
+      return result;
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+      if (bytes <= m_threshold)
+        m_small->deallocate(p, bytes, alignment);
+      else
+      {
+        m_large->deallocate(p, bytes, alignment);
+        m_largeBytes -= bytes;
+      }
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+      return this == &other;
+    }
+
+  private:
+    std::pmr::memory_resource * m_small;
+    std::pmr::memory_resource * m_large;
+    const std::size_t m_threshold;
+    std::size_t m_largeBytes{0};
+  };
+
+
+
+  // The memory for a KV group: its cache map (ankerl::unordered_dense::map), the keys (CachedKey),
+  // values (CachedValue) and the data of a VectorValue are all allocated from here.
+  //
+  // Each group has its own instance, so releasing a group's memory is done in bulk
+  // by destroying the GroupMemory, rather than destroying each entry in the map.
+  //
+  //  - reserved: bytes the monotonic resource has requested from the heap, plus live large allocations
+  //  - used: bytes currently allocated, i.e. live keys and values
+  //
+  // Allocations larger than the pool's largest block go straight to the heap, so are freed when
+  // a large value is replaced or removed.
+  class GroupMemory
+  {
+  public:
+    // When the required size is known, i.e. compacting, options.initialSize is set 
+    // to avoid reserving more than required.
     #ifdef FC_DEBUG
-      VectorMemory() :  m_fixedResource(1024),
-                        m_fixedPrint("Value Mono", &m_fixedResource),
-                        m_poolResource(&m_fixedPrint),
-                        m_poolPrint("Value Pool", &m_poolResource),
-                        m_alloc(&m_poolResource)
+      explicit GroupMemory(const MemoryOptions& options = MemoryOptions::defaults()) :
+                      m_reserved(std::pmr::new_delete_resource()),
+                      m_fixedResource(options.initialSize, &m_reserved),
+                      m_fixedPrint("Group Mono", &m_fixedResource),
+                      m_poolResource(options.pool, &m_fixedPrint),
+                      m_poolPrint("Group Pool", &m_poolResource),
+                      m_large(&m_poolPrint, &m_reserved, m_poolResource.options().largest_required_pool_block),
+                      m_used(&m_large, true)
       {
       }
     #else
-      VectorMemory() :  m_fixedResource(1024),  // this size is irrelevant: pool determines alloc sizes
-                        m_poolResource(&m_fixedResource),
-                        m_alloc(&m_poolResource)
+      explicit GroupMemory(const MemoryOptions& options = MemoryOptions::defaults()) :
+                      m_reserved(std::pmr::new_delete_resource()),
+                      m_fixedResource(options.initialSize, &m_reserved),
+                      m_poolResource(options.pool, &m_fixedResource),
+                      m_large(&m_poolResource, &m_reserved, m_poolResource.options().largest_required_pool_block),
+                      m_used(&m_large, true)
       {
       }
     #endif
 
+    ~GroupMemory() = default;
 
-  public:
-    ~VectorMemory() = default;
+    GroupMemory(const GroupMemory&) = delete;
+    GroupMemory& operator=(const GroupMemory&) = delete;
 
 
-    static std::pmr::memory_resource * getPool() noexcept
+    std::pmr::memory_resource * pool() noexcept
     {
-      return get().pool();
+      return &m_used;
     }
 
-    static std::pmr::polymorphic_allocator<>& alloc() noexcept
+    std::size_t bytesUsed() const noexcept
     {
-      return get().m_alloc;
+      return m_used.bytes();
     }
 
-  private:
-
-    static VectorMemory& get()
+    std::size_t bytesReserved() const noexcept
     {
-      static VectorMemory mem;
-      return mem;
+      return m_reserved.bytes();
     }
 
-    std::pmr::memory_resource * pool() noexcept
+    // bytes used by allocations which bypass the pool
+    std::size_t bytesLarge() const noexcept
     {
-      #ifdef FC_DEBUG
-        return &m_poolPrint; 
-      #else
-        return &m_poolResource;     
-      #endif
+      return m_large.largeBytes();
     }
 
 
   private:
     #ifdef FC_DEBUG
+      CountingResource m_reserved;
       std::pmr::monotonic_buffer_resource m_fixedResource;
       PrintResource m_fixedPrint;
       std::pmr::unsynchronized_pool_resource m_poolResource;
-      PrintResource m_poolPrint;     
+      PrintResource m_poolPrint;
+      LargeBlockResource m_large;
+      CountingResource m_used;
     #else
+      CountingResource m_reserved;
       std::pmr::monotonic_buffer_resource m_fixedResource;
       std::pmr::unsynchronized_pool_resource m_poolResource;
+      LargeBlockResource m_large;
+      CountingResource m_used;
     #endif
-
-    std::pmr::polymorphic_allocator<> m_alloc;
   };
-
-  
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <vector>
 #include <thread>
 #include <fstream>
@@ -9,6 +10,8 @@
 #include <fc/FlatBuffers.hpp>
 #include <fc/KvHandler.hpp>
 #include <fc/ListHandler.hpp>
+#include <fc/LazyFree.hpp>
+#include <fc/WorkerPool.hpp>
 
 
 namespace fc
@@ -26,7 +29,7 @@ namespace fc
       stop();
     }
 
-    bool init();
+    bool init(const bool lazyFree, const bool defrag, const std::size_t maxBlobSize);
     bool start(const std::string& ip, const int port, const unsigned int maxPayload, const std::size_t core);
     void stop() ;
 
@@ -38,6 +41,10 @@ namespace fc
 
     inline void handleKv(WebSocket * ws, FlatBuilder& fbb, const fc::request::Request& request);
     inline void handleList(WebSocket * ws, FlatBuilder& fbb, const fc::request::Request& request);
+    inline void handleServer(WebSocket * ws, FlatBuilder& fbb, const fc::request::Request& request);
+
+    void serverInfo(FlatBuilder& fbb);
+    void onMonitorTimer();
 
     template<typename BodyT>
     void callKvHandler(FlatBuilder& fbb, const fc::request::Request& request)
@@ -54,16 +61,28 @@ namespace fc
     }
 
   private:
+    // timer which runs on the event loop, used for work when the server is idle
+    static constexpr int MonitorIntervalMs = 1000;
+
     struct TimerData
     {
-      // TODO use when KV expiry is implemented
+      // TODO KV expiry
+      Server * server;
     };
 
     std::unique_ptr<std::jthread> m_wsThread;
     std::vector<us_listen_socket_t *> m_sockets;
     std::set<WebSocket *> m_clients;
     std::atomic_bool m_run;
-    //us_timer_t * m_monitorTimer{};
+    us_timer_t * m_monitorTimer{};
+    uWS::Loop * m_loop{};   // the event loop's, set on the loop's thread
+    bool m_defrag{false};
+    std::uint64_t m_nextSessionId{1};   // for WsSession::id
+    std::chrono::steady_clock::time_point m_lastMessage;
+
+    // declared before the handlers, which hold a reference
+    std::unique_ptr<LazyFree> m_lazyFree;
+    std::unique_ptr<WorkerPool> m_workers;
 
     // could be a unique_ptr but when the Timer is used for key expiry,
     // this needs to be in the TimerData struct for the timer callback.
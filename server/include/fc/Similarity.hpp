@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <fc/FlatBuffers.hpp>
+#include <fc/TypedVector.hpp>
+
+
+namespace fc
+{
+  // Similarity kernels and top-k selection for KVNearest, which compares a query with every float
+  // vector value of the same length.
+  //
+  // Values are read with fc::load(). Lanes is 16 so that with AVX-512 the float accumulators are one
+  // register, and with AVX2 they are two.
+  namespace similarity
+  {
+    constexpr std::size_t Lanes = 16U;
+
+
+    inline float reduce (const float (&lanes)[Lanes]) noexcept
+    {
+      float total{0};
+      for (const auto lane : lanes)
+        total += lane;
+      return total;
+    }
+
+
+    inline float dot (const std::uint8_t * data, const float * query, const std::size_t size) noexcept
+    {
+      float lanes[Lanes]{};
+      std::size_t i = 0;
+
+      for ( ; i + Lanes <= size ; i += Lanes)
+      {
+        for (std::size_t l = 0 ; l < Lanes ; ++l)
+          lanes[l] += load<float>(data, i+l) * query[i+l];
+      }
+
+      float total = reduce(lanes);
+
+      for ( ; i < size ; ++i)
+        total += load<float>(data, i) * query[i];
+
+      return total;
+    }
+
+
+    // The dot product and the value's squared norm, in one pass
+    inline std::pair<float, float> dotNorm (const std::uint8_t * data, const float * query, const std::size_t size) noexcept
+    {
+      float dotLanes[Lanes]{}, normLanes[Lanes]{};
+      std::size_t i = 0;
+
+      for ( ; i + Lanes <= size ; i += Lanes)
+      {
+        for (std::size_t l = 0 ; l < Lanes ; ++l)
+        {
+          const auto v = load<float>(data, i+l);
+          dotLanes[l] += v * query[i+l];
+          normLanes[l] += v * v;
+        }
+      }
+
+      float dot = reduce(dotLanes), norm = reduce(normLanes);
+
+      for ( ; i < size ; ++i)
+      {
+        const auto v = load<float>(data, i);
+        dot += v * query[i];
+        norm += v * v;
+      }
+
+      return {dot, norm};
+    }
+
+
+    // Squared Euclidean distance
+    inline float l2 (const std::uint8_t * data, const float * query, const std::size_t size) noexcept
+    {
+      float lanes[Lanes]{};
+      std::size_t i = 0;
+
+      for ( ; i + Lanes <= size ; i += Lanes)
+      {
+        for (std::size_t l = 0 ; l < Lanes ; ++l)
+        {
+          const auto d = load<float>(data, i+l) - query[i+l];
+          lanes[l] += d * d;
+        }
+      }
+
+      float total = reduce(lanes);
+
+      for ( ; i < size ; ++i)
+      {
+        const auto d = load<float>(data, i) - query[i];
+        total += d * d;
+      }
+
+      return total;
+    }
+
+
+    // A value's rank, where higher is more similar, so L2 is the negative squared distance.
+    // Returns NaN if the value can't be ranked, i.e. a zero vector for cosine.
+    template<fc::request::Metric M>
+    inline float rank (const std::uint8_t * data, const std::span<const float> query, const float queryNorm) noexcept
+    {
+      using enum fc::request::Metric;
+
+      if constexpr (M == Metric_Dot)
+        return dot(data, query.data(), query.size());
+      else if constexpr (M == Metric_Cosine)
+      {
+        const auto [d, norm] = dotNorm(data, query.data(), query.size());
+        return norm > 0 ? d / (std::sqrt(norm) * queryNorm) : std::nanf("");
+      }
+      else
+        return -l2(data, query.data(), query.size());
+    }
+
+    // The score returned for a rank: L2 returns the distance
+    inline float score (const fc::request::Metric metric, const float rank) noexcept
+    {
+      return metric == fc::request::Metric_L2 ? std::sqrt(-rank) : rank;
+    }
+
+
+    struct Candidate
+    {
+      float rank;
+      std::size_t index;  // of the value in the map's values
+    };
+
+
+    // Keeps the k candidates with the highest rank, in a min-heap so the lowest is replaced.
+    // The heap's capacity must be reserved, so that push() doesn't allocate.
+    class TopK
+    {
+    public:
+      explicit TopK (const std::size_t k) : m_k(k)
+      {
+        m_heap.reserve(k);
+      }
+
+      void push (const Candidate c) noexcept
+      {
+        if (m_heap.size() < m_k)
+        {
+          m_heap.push_back(c);
+          std::push_heap(m_heap.begin(), m_heap.end(), greater);
+        }
+        else if (c.rank > m_heap.front().rank)
+        {
+          std::pop_heap(m_heap.begin(), m_heap.end(), greater);
+          m_heap.back() = c;
+          std::push_heap(m_heap.begin(), m_heap.end(), greater);
+        }
+      }
+
+      void merge (const TopK& other) noexcept
+      {
+        for (const auto c : other.m_heap)
+          push(c);
+      }
+
+      // Candidates, most similar first. The heap is no longer valid.
+      const std::vector<Candidate>& sorted () noexcept
+      {
+        std::sort(m_heap.begin(), m_heap.end(), greater);
+        return m_heap;
+      }
+
+    private:
+      static bool greater (const Candidate& a, const Candidate& b) noexcept
+      {
+        return a.rank > b.rank;
+      }
+
+    private:
+      std::size_t m_k;
+      std::vector<Candidate> m_heap;
+    };
+  }
+}
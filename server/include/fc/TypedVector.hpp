@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fc/FlatBuffers.hpp>
+
+
+namespace fc
+{
+  // A flexbuffers typed vector of scalars is a contiguous little endian array, but flexbuffers
+  // only offers per element access, which switches on type and width for every element.
+  // These read the array directly so a vector is converted in bulk.
+  struct TypedVectorAccess : public flexbuffers::TypedVector
+  {
+    static const std::uint8_t * data (const flexbuffers::TypedVector& v) noexcept
+    {
+      return v.*(&TypedVectorAccess::data_);
+    }
+
+    static std::uint8_t byteWidth (const flexbuffers::TypedVector& v) noexcept
+    {
+      return v.*(&TypedVectorAccess::byte_width_);
+    }
+  };
+
+
+  // Element i of an array of T. Stored arrays follow a size or flexbuffers header, so may not be aligned
+  // for T: memcpy compiles to a plain (unaligned) load, where casting the pointer would be undefined.
+  //
+  // Kernels over these arrays (aggregate, bitmap, similarity) keep Lanes independent accumulators: the
+  // compiler can't reorder a single accumulator's floating point adds, so that loop is serial, but
+  // independent lanes map to SIMD registers and hide the add latency.
+  template<typename T>
+  inline T load (const std::uint8_t * data, const std::size_t i = 0) noexcept
+  {
+    T v;
+    std::memcpy(&v, data + i*sizeof(T), sizeof(T));
+    return v;
+  }
+
+
+  template<typename SrcT, typename DestT>
+  void convertScalars (const std::uint8_t * src, const std::size_t size, std::uint8_t * dest) noexcept
+  {
+    if constexpr (std::is_same_v<SrcT, DestT>)
+      std::memcpy(dest, src, size * sizeof(DestT));
+    else
+    {
+      // simple enough for the compiler to vectorise
+      for (std::size_t i = 0 ; i < size ; ++i)
+      {
+        const auto d = static_cast<DestT>(load<SrcT>(src, i));
+        std::memcpy(dest + i*sizeof(DestT), &d, sizeof(DestT));
+      }
+    }
+  }
+
+
+  // Copies v's elements to dest as an array of ValueT, which must have space for v.size() elements.
+  // Returns false if the element type/width is not handled, in which case the caller should use v[i].As<ValueT>().
+  template<typename ValueT>
+  bool copyFromTypedVector (const flexbuffers::TypedVector& v, std::uint8_t * dest) noexcept
+  {
+    if constexpr (std::endian::native != std::endian::little)
+      return false;
+    else
+    {
+      const auto src = TypedVectorAccess::data(v);
+      const auto width = TypedVectorAccess::byteWidth(v);
+      const auto size = v.size();
+      const auto elementType = flexbuffers::TypedVector{v}.ElementType();
+
+      if constexpr (std::is_same_v<ValueT, bool>)
+      {
+        if (elementType != FlexType::FBT_BOOL || width != 1)
+          return false;
+
+        for (std::size_t i = 0 ; i < size ; ++i)
+          dest[i] = src[i] != 0;
+      }
+      else if constexpr (std::is_integral_v<ValueT>)
+      {
+        if (elementType == FlexType::FBT_INT)
+        {
+          switch (width)
+          {
+            case 1: convertScalars<std::int8_t, ValueT>(src, size, dest); break;
+            case 2: convertScalars<std::int16_t, ValueT>(src, size, dest); break;
+            case 4: convertScalars<std::int32_t, ValueT>(src, size, dest); break;
+            case 8: convertScalars<std::int64_t, ValueT>(src, size, dest); break;
+            default: return false;
+          }
+        }
+        else if (elementType == FlexType::FBT_UINT)
+        {
+          switch (width)
+          {
+            case 1: convertScalars<std::uint8_t, ValueT>(src, size, dest); break;
+            case 2: convertScalars<std::uint16_t, ValueT>(src, size, dest); break;
+            case 4: convertScalars<std::uint32_t, ValueT>(src, size, dest); break;
+            case 8: convertScalars<std::uint64_t, ValueT>(src, size, dest); break;
+            default: return false;
+          }
+        }
+        else
+          return false;
+      }
+      else if constexpr (std::is_floating_point_v<ValueT>)
+      {
+        if (elementType != FlexType::FBT_FLOAT)
+          return false;
+        else if (width == 4)
+          convertScalars<float, ValueT>(src, size, dest);
+        else if (width == 8)
+          convertScalars<double, ValueT>(src, size, dest);
+        else
+          return false;
+      }
+      else
+        return false;
+
+      return true;
+    }
+  }
+
+
+  // The narrowest integer type of Bytes with ValueT's signedness
+  template<typename ValueT, std::size_t Bytes>
+  using NarrowIntT = std::conditional_t<Bytes == 1, std::conditional_t<std::is_signed_v<ValueT>, std::int8_t, std::uint8_t>,
+                     std::conditional_t<Bytes == 2, std::conditional_t<std::is_signed_v<ValueT>, std::int16_t, std::uint16_t>,
+                     std::conditional_t<Bytes == 4, std::conditional_t<std::is_signed_v<ValueT>, std::int32_t, std::uint32_t>,
+                                                    ValueT>>>;
+
+
+  // The fewest bytes which hold every element, as flexbuffers chooses when elements are added with Add().
+  // One pass for min and max, simple enough for the compiler to vectorise.
+  template<typename ValueT>
+  std::size_t minIntWidth (const ValueT * values, const std::size_t size) noexcept
+  {
+    ValueT min{0}, max{0};
+    for (std::size_t i = 0 ; i < size ; ++i)
+    {
+      min = std::min(min, values[i]);
+      max = std::max(max, values[i]);
+    }
+
+    const auto fits = [min, max]<std::size_t Bytes>()
+    {
+      using NarrowT = NarrowIntT<ValueT, Bytes>;
+      return std::cmp_greater_equal(min, std::numeric_limits<NarrowT>::min()) &&
+             std::cmp_less_equal(max, std::numeric_limits<NarrowT>::max());
+    };
+
+    if (fits.template operator()<1>())
+      return 1;
+    else if (fits.template operator()<2>())
+      return 2;
+    else if (fits.template operator()<4>())
+      return 4;
+    else
+      return sizeof(ValueT);
+  }
+
+
+  // Adds a typed vector from an array, which is written in bulk rather than with an Add() per element.
+  // Integers are written at the minimum width, as Add() would: they're narrowed to a temporary array
+  // when that is less than sizeof(ValueT).
+  template<typename ValueT>
+  void addTypedVector (FlexBuilder& fb, const char * key, const ValueT * values, const std::size_t size)
+  {
+    const auto write = [&fb, key, size]<typename T>(const T * data)
+    {
+      if (key)
+        fb.Vector(key, data, size);
+      else
+        fb.Vector(data, size);
+    };
+
+    // a bulk write's elements can't be narrower than the vector's size field
+    const std::size_t sizeWidth = std::size_t{1} << flexbuffers::WidthU(size);
+
+    if constexpr (std::is_integral_v<ValueT> && !std::is_same_v<ValueT, bool>)
+    {
+      const auto narrow = [values, size, &write]<typename NarrowT>()
+      {
+        std::vector<NarrowT> narrowed(size);
+        convertScalars<ValueT, NarrowT>(reinterpret_cast<const std::uint8_t *>(values), size, reinterpret_cast<std::uint8_t *>(narrowed.data()));
+        write(narrowed.data());
+      };
+
+      switch (std::max(sizeWidth, minIntWidth(values, size)))
+      {
+        case 1: narrow.template operator()<NarrowIntT<ValueT, 1>>(); break;
+        case 2: narrow.template operator()<NarrowIntT<ValueT, 2>>(); break;
+        case 4: narrow.template operator()<NarrowIntT<ValueT, 4>>(); break;
+        default: write(values); break;
+      }
+    }
+    else if (sizeWidth <= sizeof(ValueT))
+      write(values);
+    else
+    {
+      // i.e. more than 255 bools: flexbuffers widens the elements to the size field
+      const auto add = [&fb, values, size]
+      {
+        for (std::size_t i = 0 ; i < size ; ++i)
+          fb.Add(values[i]);
+      };
+
+      if (key)
+        fb.TypedVector(key, add);
+      else
+        fb.TypedVector(add);
+    }
+  }
+}
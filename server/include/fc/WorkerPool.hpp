@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace fc
+{
+  // Threads created at startup which run the parts of a request in parallel, i.e. the shards of
+  // a KVNearest scan, so a request doesn't create and join threads.
+  //
+  // Only the event loop thread calls run(), so there is one job at a time and the pool's threads
+  // are never oversubscribed.
+  class WorkerPool
+  {
+  public:
+    // threads includes the caller's, so threads - 1 are created
+    explicit WorkerPool(const std::size_t threads);
+    ~WorkerPool() = default;
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+
+    // Threads available to run(), including the caller's
+    std::size_t size() const noexcept { return m_threads.size() + 1; }
+
+    // Calls task(0) to task(parts - 1), task(0) on the caller's thread and the others on the pool's
+    // threads, returning when all have finished. parts must be <= size() and task must not throw.
+    void run (const std::size_t parts, const std::function<void(std::size_t)>& task);
+
+
+  private:
+    void work (std::stop_token stop, const std::size_t part);
+
+
+  private:
+    std::mutex m_mux;
+    std::condition_variable_any m_start;
+    std::condition_variable m_done;
+    const std::function<void(std::size_t)> * m_task{nullptr};
+    std::size_t m_parts{0};
+    std::size_t m_remaining{0};   // parts yet to finish on the pool's threads
+    std::uint64_t m_job{0};       // incremented for each run()
+    std::vector<std::jthread> m_threads;  // last member: destroyed (stopped and joined) first
+  };
+}
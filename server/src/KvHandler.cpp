@@ -1,6 +1,9 @@
 #include <fc/KvHandler.hpp>
 #include <fc/FlatBuffers.hpp>
 #include <plog/Log.h>
+#include <malloc.h>
+#include <algorithm>
+#include <vector>
 
 
 namespace fc
@@ -19,7 +22,7 @@ namespace fc
       {
         if (const auto opt = getOrCreateGroup(group->str()); opt)
         {
-          valid = setOrAdd<true>((*opt)->second.kv, keys, values);
+          valid = setOrAdd<true>((*opt)->second.kv(), keys, values);
         }
       }
       else
@@ -48,7 +51,7 @@ namespace fc
       {
         if (const auto opt = getOrCreateGroup(group->str()); opt)
         {
-          valid = setOrAdd<false>((*opt)->second.kv, keys, values);
+          valid = setOrAdd<false>((*opt)->second.kv(), keys, values);
         }
       }
       else
@@ -84,19 +87,34 @@ namespace fc
         if (group && !group->empty())
         {
           if (const auto optGroup = getGroup(group->str()); optGroup)
-            map = &(*optGroup)->second.kv;
+            map = &(*optGroup)->second.kv();
           else
           {
             // TODO Status_NotExist?
           }
         }
         else
-          map = &m_map;
+          map = &m_default.kv();
 
 
+        if (req.if_changed() && !changed(map, req.if_changed_flexbuffer_root().AsMap()))
+        {
+          createEmptyBodyResponse(fbb, Status_NotModified, ResponseBody_KVGet);
+          return;
+        }
+
         if (map)
         {
-          if (req.keys())
+          if (req.size_only())
+          {
+            if (req.keys())
+              map->sizes(*req.keys(), flxb);
+            else
+              map->sizes(flxb);
+          }
+          else if (req.keys() && req.slices())
+            map->get(*req.keys(), flxb, req.slices_flexbuffer_root().AsMap());
+          else if (req.keys())
             map->get(*req.keys(), flxb);
           else
             map->get(flxb);
@@ -108,8 +126,26 @@ namespace fc
 
         flxb.Finish();
 
+        flatbuffers::Offset<BufferVector> versionsVec;
+
+        if (req.versions())
+        {
+          FlexBuilder versionsFlxb;
+
+          if (!map)
+            versionsFlxb.Map([]{});
+          else if (req.keys())
+            map->versions(*req.keys(), versionsFlxb);
+          else
+            map->versions(versionsFlxb);
+
+          versionsFlxb.Finish();
+          versionsVec = fbb.CreateVector(versionsFlxb.GetBuffer());
+        }
+
         const auto vec = fbb.CreateVector(flxb.GetBuffer());  // place the flex buffer vector in the flat buffer
-        const auto body = fc::response::CreateKVGet(fbb, vec);
+        const bool encoded = map && map->isEncoded() && !req.size_only();
+        const auto body = fc::response::CreateKVGet(fbb, vec, versionsVec, encoded);
         
         auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVGet, body.Union());
         fbb.Finish(rsp);
@@ -136,12 +172,12 @@ namespace fc
         {
           if (const auto opt = getGroup(group->str()); opt)
           {
-            (*opt)->second.kv.remove(*req.keys());
+            (*opt)->second.kv().remove(*req.keys());
           }
         }
         else
         {
-          m_map.remove(*req.keys());
+          m_default.kv().remove(*req.keys());
         }
       }
 
@@ -163,11 +199,11 @@ namespace fc
     {
       if (const auto opt = getGroup(group->str()); opt)
       {
-        count = (*opt)->second.kv.count();
+        count = (*opt)->second.kv().count();
       }
     }
     else
-      count = m_map.count();
+      count = m_default.kv().count();
     
     const auto body = fc::response::CreateKVCount(fbb, count);
     const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVCount, body.Union());
@@ -187,7 +223,7 @@ namespace fc
       {
         if (const auto opt = getGroup(group->str()); opt)
         {
-          (*opt)->second.kv.contains(flxb, *req.keys());
+          (*opt)->second.kv().contains(flxb, *req.keys());
         }
         else
         {
@@ -195,7 +231,7 @@ namespace fc
         }
       }
       else
-        m_map.contains(flxb, *req.keys());
+        m_default.kv().contains(flxb, *req.keys());
 
       flxb.Finish();
 
@@ -219,18 +255,23 @@ namespace fc
         using enum fc::request::ClearOperation;
 
         case ClearOperation_All:
-          m_groups.clear();
-          valid = m_map.clear();
+          m_lazyFree.release(std::exchange(m_groups, GroupMap{}));
+          m_lazyFree.release(m_default.clear());
         break;
 
         case ClearOperation_Groups:
-          m_groups.clear();
+          m_lazyFree.release(std::exchange(m_groups, GroupMap{}));
         break;
 
         case ClearOperation_GroupsKeysOnly:
         {
+          std::vector<std::unique_ptr<GroupMemory>> memory;
+          memory.reserve(m_groups.size());
+
           for (auto& group : m_groups)
-            group.second.kv.clear();
+            memory.emplace_back(group.second.clear());
+
+          m_lazyFree.release(std::move(memory));
         }
         break;
 
@@ -242,9 +283,12 @@ namespace fc
             if (const auto opt = getGroup(group->str()); opt)
             {
               if (req.op() == ClearOperation_GroupKeysOnly)
-                valid = (*opt)->second.kv.clear();
+                m_lazyFree.release((*opt)->second.clear());
               else
-                m_groups.erase(group->str());
+              {
+                m_lazyFree.release(std::move((*opt)->second));
+                m_groups.erase(*opt);
+              }
             }
           }
         }
@@ -274,13 +318,13 @@ namespace fc
       {
         if (const auto opt = getGroup(group->str()); opt)
         {
-          (*opt)->second.kv.clear();
-          valid = setOrAdd<true>((*opt)->second.kv, keys, values);
+          m_lazyFree.release((*opt)->second.clear());
+          valid = setOrAdd<true>((*opt)->second.kv(), keys, values);
         }
       }
       else
       {
-        m_map.clear();
+        m_lazyFree.release(m_default.clear());
         valid = setOrAdd<true>(keys, values);
       }
     }
@@ -292,4 +336,1139 @@ namespace fc
 
     createEmptyBodyResponse(fbb, valid ? Status_Ok : Status_Fail, ResponseBody_KVClearSet);
   }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVGroupInfo& req) noexcept
+  {
+    try
+    {
+      const Group * group{nullptr};
+
+      if (const auto name = req.group(); name && !name->empty())
+      {
+        if (const auto opt = getGroup(name->str()); opt)
+          group = &(*opt)->second;
+      }
+      else
+        group = &m_default;
+
+      if (!group)
+        createEmptyBodyResponse(fbb, Status_NotExist, ResponseBody_KVGroupInfo);
+      else
+      {
+        const auto& map = group->kv();
+        const auto& rehash = map.rehashStats();
+        const auto body = fc::response::CreateKVGroupInfo(fbb, map.count(), group->bytesUsed(), group->bytesReserved(), group->isOrdered(), group->isEncoded(),
+                                                               group->isCompressed(), map.compressedBytes(), map.uncompressedBytes(),
+                                                               rehash.count, rehash.total.count(), rehash.max.count());
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVGroupInfo, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVGroupInfo);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVIncr& req) noexcept
+  {
+    addNumeric(fbb, req, ResponseBody_KVIncr, fc::response::CreateKVIncr, [](CacheMap& map, const KeyView& key, const flexbuffers::Reference amount)
+    {
+      return map.addInt(key, amount.AsInt64());
+    });
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVDecr& req) noexcept
+  {
+    addNumeric(fbb, req, ResponseBody_KVDecr, fc::response::CreateKVDecr, [](CacheMap& map, const KeyView& key, const flexbuffers::Reference amount)
+    {
+      // min() can't be negated, so clamp to -max()
+      const auto delta = std::max<fcint>(amount.AsInt64(), -std::numeric_limits<fcint>::max());
+      return map.addInt(key, -delta);
+    });
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVAddFloat& req) noexcept
+  {
+    addNumeric(fbb, req, ResponseBody_KVAddFloat, fc::response::CreateKVAddFloat, [](CacheMap& map, const KeyView& key, const flexbuffers::Reference amount)
+    {
+      return map.addFloat(key, amount.AsFloat());
+    });
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVCas& req) noexcept
+  {
+    if (!req.versions())
+      createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVCas);
+    else
+    {
+      const auto versions = req.versions_flexbuffer_root().AsMap();
+
+      updateKeys(fbb, req, ResponseBody_KVCas, fc::response::CreateKVCas, [&versions](CacheMap& map, const KeyView& key, const char * keyString, const flexbuffers::Reference value, FlexBuilder& flxb)
+      {
+        // a key without an expected version fails
+        const auto expected = versions[keyString];
+        const bool set = !expected.IsNull() && 
+                          map.version(key) == expected.AsUInt64() &&
+                          map.setOrAdd<true>(key, value);
+
+        flxb.Bool(keyString, set);
+      });
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVAppend& req) noexcept
+  {
+    updateKeys(fbb, req, ResponseBody_KVAppend, fc::response::CreateKVAppend, [this](CacheMap& map, const KeyView& key, const char * keyString, const flexbuffers::Reference value, FlexBuilder& flxb)
+    {
+      if (const auto size = map.append(key, value, m_maxBlobSize); size)
+        flxb.UInt(keyString, *size);
+    });
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVWriteAt& req) noexcept
+  {
+    if (!req.offsets())
+      createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVWriteAt);
+    else
+    {
+      const auto offsets = req.offsets_flexbuffer_root().AsMap();
+
+      updateKeys(fbb, req, ResponseBody_KVWriteAt, fc::response::CreateKVWriteAt, [this, &offsets](CacheMap& map, const KeyView& key, const char * keyString, const flexbuffers::Reference value, FlexBuilder& flxb)
+      {
+        if (const auto offset = offsets[keyString]; !offset.IsNull())
+        {
+          if (const auto size = map.writeAt(key, offset.AsUInt64(), value, m_maxBlobSize); size)
+            flxb.UInt(keyString, *size);
+        }
+      });
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVScan& req) noexcept
+  {
+    try
+    {
+      const CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+      {
+        if (const auto opt = getGroup(group->str()); opt)
+          map = &(*opt)->second.kv();
+      }
+      else
+        map = &m_default.kv();
+
+      FlexBuilder flxb{4096U};
+      std::uint64_t cursor{0};
+
+      if (map)
+      {
+        const auto count = std::clamp<std::size_t>(req.count(), 1U, ScanMaxCount);
+        const auto match = req.match() ? req.match()->string_view() : std::string_view{};
+        cursor = map->scan(flxb, req.cursor(), count, match, req.keys_only());
+      }
+      else if (req.keys_only())
+        flxb.TypedVector([]{});
+      else
+        flxb.Map([]{});
+
+      flxb.Finish();
+
+      const auto vec = fbb.CreateVector(flxb.GetBuffer());
+      const bool encoded = map && map->isEncoded() && !req.keys_only();
+      const auto body = fc::response::CreateKVScan(fbb, cursor, vec, encoded);
+      const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVScan, body.Union());
+      fbb.Finish(rsp);
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVScan);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVGroupCreate& req) noexcept
+  {
+    try
+    {
+      // an encoded value is a flexbuffer, so compressing is not supported
+      if (const auto group = req.group(); !group || group->empty() || (req.encoded() && req.compressed()) || req.reserve() > GroupMaxReserve)
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVGroupCreate);
+      else
+      {
+        const MapOptions options {.ordered = req.ordered(), .encoded = req.encoded(), .compressed = req.compressed(), .reserve = req.reserve()};
+        const auto [_, created] = m_groups.try_emplace(group->str(), MemoryOptions::defaults(), options);
+        createEmptyBodyResponse(fbb, created ? Status_Ok : Status_Duplicate, ResponseBody_KVGroupCreate);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVGroupCreate);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVGetPrefix& req) noexcept
+  {
+    try
+    {
+      const auto group = req.group() ? getGroup(req.group()->str()) : std::nullopt;
+
+      if (!group)
+        createEmptyBodyResponse(fbb, Status_NotExist, ResponseBody_KVGetPrefix);
+      else if (const auto& map = (*group)->second.kv(); !map.isOrdered())
+        createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVGetPrefix);
+      else
+      {
+        FlexBuilder flxb{4096U};
+
+        const auto prefix = req.prefix() ? req.prefix()->string_view() : std::string_view{};
+        map.getPrefix(flxb, prefix, req.keys_only(), req.limit());
+        flxb.Finish();
+
+        const auto vec = fbb.CreateVector(flxb.GetBuffer());
+        const auto body = fc::response::CreateKVGetPrefix(fbb, vec, map.isEncoded() && !req.keys_only());
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVGetPrefix, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVGetPrefix);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVRangeKeys& req) noexcept
+  {
+    try
+    {
+      const auto group = req.group() ? getGroup(req.group()->str()) : std::nullopt;
+
+      if (!group)
+        createEmptyBodyResponse(fbb, Status_NotExist, ResponseBody_KVRangeKeys);
+      else if (const auto& map = (*group)->second.kv(); !map.isOrdered())
+        createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVRangeKeys);
+      else
+      {
+        FlexBuilder flxb{4096U};
+
+        const auto start = req.start() ? req.start()->string_view() : std::string_view{};
+        const auto end = req.end() ? req.end()->string_view() : std::string_view{};
+        map.rangeKeys(flxb, start, end, req.limit());
+        flxb.Finish();
+
+        const auto vec = fbb.CreateVector(flxb.GetBuffer());
+        const auto body = fc::response::CreateKVRangeKeys(fbb, vec);
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVRangeKeys, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVRangeKeys);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVChunkBegin& req, const std::uint64_t session) noexcept
+  {
+    try
+    {
+      if (m_uploads.size() >= MaxUploads)
+      {
+        // forget uploads whose group has since been cleared or deleted
+        for (auto it = m_uploads.begin() ; it != m_uploads.end() ; )
+          it = getUploadGroup(it->first) ? std::next(it) : m_uploads.erase(it);
+      }
+      
+      if (!req.key() || req.key()->size() == 0 || req.size() > m_maxBlobSize)
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVChunkBegin);
+      else if (m_uploads.size() >= MaxUploads)
+        createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVChunkBegin);
+      else
+      {
+        const auto groupName = req.group() ? req.group()->str() : std::string{};
+        Group& group = groupName.empty() ? m_default : (*getOrCreateGroup(groupName))->second;
+
+        if (group.isEncoded())
+          createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVChunkBegin);
+        else
+        {
+          const auto id = m_nextUploadId++;
+
+          group.beginUpload(id, req.key()->string_view(), static_cast<fcblobsize>(req.size()));
+          m_uploads.emplace(id, UploadOwner{.group = groupName, .session = session});
+
+          const auto body = fc::response::CreateKVChunkBegin(fbb, id);
+          const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVChunkBegin, body.Union());
+          fbb.Finish(rsp);
+        }
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVChunkBegin);
+    }
+  }
+
+
+  void KvHandler::endSession(const std::uint64_t session) noexcept
+  {
+    for (auto it = m_uploads.begin() ; it != m_uploads.end() ; )
+    {
+      if (it->second.session != session)
+        ++it;
+      else
+      {
+        if (Group * group = getUploadGroup(it->first); group)
+          group->endUpload(it->first);
+
+        it = m_uploads.erase(it);
+      }
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVChunkAppend& req) noexcept
+  {
+    try
+    {
+      if (Group * group = getUploadGroup(req.id()); !group)
+      {
+        m_uploads.erase(req.id());
+        createEmptyBodyResponse(fbb, Status_NotExist, ResponseBody_KVChunkAppend);
+      }
+      else
+      {
+        auto& upload = *group->upload(req.id());
+        auto& data = upload.value.data;
+        const auto received = data.size() - sizeof(fcblobsize);
+        
+        if (const auto chunk = req.data(); chunk && chunk->size())
+        {
+          if (received + chunk->size() > upload.size)
+          {
+            createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVChunkAppend);
+            return;
+          }
+
+          // grows geometrically, but never beyond the declared size
+          if (const auto required = data.size() + chunk->size(); required > data.capacity())
+            data.reserve(std::min<std::size_t>(std::max(required, data.capacity() * 2), sizeof(fcblobsize) + upload.size));
+
+          data.insert(data.end(), chunk->cbegin(), chunk->cend());
+        }
+
+        const auto body = fc::response::CreateKVChunkAppend(fbb, data.size() - sizeof(fcblobsize));
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVChunkAppend, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVChunkAppend);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVChunkCommit& req) noexcept
+  {
+    auto status = Status_Ok;
+
+    try
+    {
+      if (Group * group = getUploadGroup(req.id()); !group)
+      {
+        m_uploads.erase(req.id());
+        status = Status_NotExist;
+      }
+      else if (req.abort())
+      {
+        group->endUpload(req.id());
+        m_uploads.erase(req.id());
+      }
+      else if (auto& upload = *group->upload(req.id()); upload.value.data.size() - sizeof(fcblobsize) != upload.size)
+      {
+        // incomplete, the client can continue or abort
+        status = Status_Fail;
+      }
+      else
+      {
+        group->kv().setBlob(KeyView{upload.key}, std::move(upload.value));
+        group->endUpload(req.id());
+        m_uploads.erase(req.id());
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      status = Status_Fail;
+    }
+
+    createEmptyBodyResponse(fbb, status, ResponseBody_KVChunkCommit);
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVChunkGet& req) noexcept
+  {
+    try
+    {
+      const CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+      {
+        if (const auto opt = getGroup(group->str()); opt)
+          map = &(*opt)->second.kv();
+      }
+      else
+        map = &m_default.kv();
+
+      const KeyView key{req.key() ? req.key()->string_view() : std::string_view{}};
+
+      if (!map || !map->version(key))
+        createEmptyBodyResponse(fbb, Status_NotExist, ResponseBody_KVChunkGet);
+      else if (const auto blob = map->blob(key); !blob)
+        createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVChunkGet);
+      else if (req.offset() > blob->size())
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVChunkGet);
+      else
+      {
+        // copied from the value straight into the response
+        const auto size = std::min<std::size_t>({req.size(), ChunkMaxSize, blob->size() - req.offset()});
+        const auto data = fbb.CreateVector(blob->data() + req.offset(), size);
+        const auto body = fc::response::CreateKVChunkGet(fbb, blob->size(), data);
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVChunkGet, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVChunkGet);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVGetGroups& req) noexcept
+  {
+    try
+    {
+      if (!req.groups())
+        createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVGetGroups);
+      else
+      {
+        FlexBuilder flxb{4096U};
+        std::vector<std::string_view> names, encoded;
+
+        flxb.Map([&]
+        {
+          for (const auto& groupKeys : *req.groups())
+          {
+            const auto name = groupKeys->group() ? groupKeys->group()->string_view() : std::string_view{};
+
+            // a map can't have duplicate keys
+            if (std::find(names.cbegin(), names.cend(), name) != names.cend())
+              continue;
+
+            names.emplace_back(name);
+
+            const CacheMap * map{nullptr};
+
+            if (name.empty())
+              map = &m_default.kv();
+            else if (const auto opt = getGroup(groupKeys->group()->str()); opt)
+              map = &(*opt)->second.kv();
+
+            if (map)
+            {
+              const auto mapKey = groupKeys->group() ? groupKeys->group()->c_str() : "";
+
+              if (groupKeys->keys() && groupKeys->keys()->size())
+                map->get(mapKey, *groupKeys->keys(), flxb);
+              else
+                map->get(mapKey, flxb);
+
+              if (map->isEncoded())
+                encoded.emplace_back(name);
+            }
+          }
+        });
+
+        flxb.Finish();
+
+        std::vector<flatbuffers::Offset<flatbuffers::String>> encodedOffsets;
+        encodedOffsets.reserve(encoded.size());
+        for (const auto name : encoded)
+          encodedOffsets.emplace_back(fbb.CreateString(name));
+
+        const auto encodedVec = fbb.CreateVector(encodedOffsets);
+        const auto vec = fbb.CreateVector(flxb.GetBuffer());
+        const auto body = fc::response::CreateKVGetGroups(fbb, vec, encodedVec);
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVGetGroups, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVGetGroups);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVAggregate& req) noexcept
+  {
+    try
+    {
+      const CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+      {
+        if (const auto opt = getGroup(group->str()); opt)
+          map = &(*opt)->second.kv();
+      }
+      else
+        map = &m_default.kv();
+
+      Aggregation agg {.op = req.op(), .threshold = req.threshold()};
+
+      if (req.operand())
+        agg.operand = std::span<const double>{req.operand()->data(), req.operand()->size()};
+
+      FlexBuilder flxb;
+
+      if (!map)
+        flxb.Map([]{});
+      else if (req.keys() && req.keys()->size())
+        map->aggregate(*req.keys(), agg, flxb);
+      else
+        map->aggregate(agg, flxb);
+
+      flxb.Finish();
+
+      const auto vec = fbb.CreateVector(flxb.GetBuffer());
+      const auto body = fc::response::CreateKVAggregate(fbb, vec);
+      const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVAggregate, body.Union());
+      fbb.Finish(rsp);
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVAggregate);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVGroupSwap& req) noexcept
+  {
+    try
+    {
+      const auto group = req.group() ? getGroup(req.group()->str()) : std::nullopt;
+      const auto other = req.other() ? getGroup(req.other()->str()) : std::nullopt;
+
+      if (!group || !other)
+        createEmptyBodyResponse(fbb, Status_NotExist, ResponseBody_KVGroupSwap);
+      else if (*group == *other)
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVGroupSwap);
+      else if ((*group)->second.hasUploads() || (*other)->second.hasUploads())
+      {
+        // an upload is found by its group's name, so would be committed to the wrong group
+        createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVGroupSwap);
+      }
+      else
+      {
+        // groups own their memory, so this only exchanges pointers
+        std::swap((*group)->second, (*other)->second);
+
+        if (req.delete_other())
+        {
+          m_lazyFree.release(std::move((*other)->second));
+          m_groups.erase(*other);
+        }
+
+        createEmptyBodyResponse(fbb, Status_Ok, ResponseBody_KVGroupSwap);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVGroupSwap);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVInfo& req) noexcept
+  {
+    try
+    {
+      const CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+      {
+        if (const auto opt = getGroup(group->str()); opt)
+          map = &(*opt)->second.kv();
+      }
+      else
+        map = &m_default.kv();
+
+      FlexBuilder flxb;
+
+      if (!map)
+        flxb.Map([]{});
+      else if (req.keys() && req.keys()->size())
+        map->info(*req.keys(), flxb);
+      else
+        map->info(flxb);
+
+      flxb.Finish();
+
+      const auto vec = fbb.CreateVector(flxb.GetBuffer());
+      const auto body = fc::response::CreateKVInfo(fbb, vec);
+      const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVInfo, body.Union());
+      fbb.Finish(rsp);
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVInfo);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVFieldSet& req) noexcept
+  {
+    try
+    {
+      CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+        map = &(*getOrCreateGroup(group->str()))->second.kv();
+      else
+        map = &m_default.kv();
+
+      const KeyView key{req.key() ? req.key()->string_view() : std::string_view{}};
+
+      if (!req.fields())
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVFieldSet);
+      else if (map->version(key) && !map->hash(key))
+        createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVFieldSet);
+      else
+      {
+        const auto set = map->setFields(key, req.fields_flexbuffer_root().AsMap());
+        createEmptyBodyResponse(fbb, set ? Status_Ok : Status_Fail, ResponseBody_KVFieldSet);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVFieldSet);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVFieldGet& req) noexcept
+  {
+    try
+    {
+      const CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+      {
+        if (const auto opt = getGroup(group->str()); opt)
+          map = &(*opt)->second.kv();
+      }
+      else
+        map = &m_default.kv();
+
+      const KeyView key{req.key() ? req.key()->string_view() : std::string_view{}};
+
+      if (!map || !map->version(key))
+        createEmptyBodyResponse(fbb, Status_NotExist, ResponseBody_KVFieldGet);
+      else if (const auto hash = map->hash(key); !hash)
+        createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVFieldGet);
+      else
+      {
+        FlexBuilder flxb;
+        flxb.Map([&]{ CacheMap::getFields(flxb, *hash, req.fields()); });
+        flxb.Finish();
+
+        const auto vec = fbb.CreateVector(flxb.GetBuffer());
+        const auto body = fc::response::CreateKVFieldGet(fbb, vec);
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVFieldGet, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVFieldGet);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVFieldIncr& req) noexcept
+  {
+    try
+    {
+      CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+        map = &(*getOrCreateGroup(group->str()))->second.kv();
+      else
+        map = &m_default.kv();
+
+      const KeyView key{req.key() ? req.key()->string_view() : std::string_view{}};
+
+      if (!req.fields())
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVFieldIncr);
+      else if (map->version(key) && !map->hash(key))
+        createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVFieldIncr);
+      else
+      {
+        bool added{false};
+
+        FlexBuilder flxb;
+        flxb.Map([&]{ added = map->addFields(key, req.fields_flexbuffer_root().AsMap(), flxb); });
+        flxb.Finish();
+
+        if (!added)
+          createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVFieldIncr);
+        else
+        {
+          const auto vec = fbb.CreateVector(flxb.GetBuffer());
+          const auto body = fc::response::CreateKVFieldIncr(fbb, vec);
+          const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVFieldIncr, body.Union());
+          fbb.Finish(rsp);
+        }
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVFieldIncr);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVBitSet& req) noexcept
+  {
+    try
+    {
+      CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+        map = &(*getOrCreateGroup(group->str()))->second.kv();
+      else
+        map = &m_default.kv();
+
+      const KeyView key{req.key() ? req.key()->string_view() : std::string_view{}};
+
+      if (!req.bits() || !req.bits()->size())
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVBitSet);
+      else if (map->version(key) && (!map->blob(key) || map->hll(key)))
+        createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVBitSet);
+      else if (const auto changed = map->setBits(key, *req.bits(), req.value()); !changed)
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVBitSet);
+      else
+      {
+        const auto body = fc::response::CreateKVBitSet(fbb, *changed);
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVBitSet, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVBitSet);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVBitTest& req) noexcept
+  {
+    try
+    {
+      const CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+      {
+        if (const auto opt = getGroup(group->str()); opt)
+          map = &(*opt)->second.kv();
+      }
+      else
+        map = &m_default.kv();
+
+      const KeyView key{req.key() ? req.key()->string_view() : std::string_view{}};
+
+      if (!req.bits())
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVBitTest);
+      else if (map && map->version(key) && !map->blob(key))
+        createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVBitTest);
+      else
+      {
+        // a key that doesn't exist is an empty bitmap
+        const auto bytes = map ? map->blob(key).value_or(std::span<const std::uint8_t>{}) : std::span<const std::uint8_t>{};
+
+        std::vector<std::uint8_t> bits;
+        bits.reserve(req.bits()->size());
+
+        for (const auto bit : *req.bits())
+          bits.push_back(bitmap::test(bytes, bit));
+
+        const auto vec = fbb.CreateVector(bits);
+        const auto body = fc::response::CreateKVBitTest(fbb, vec);
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVBitTest, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVBitTest);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVBitCount& req) noexcept
+  {
+    try
+    {
+      const CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+      {
+        if (const auto opt = getGroup(group->str()); opt)
+          map = &(*opt)->second.kv();
+      }
+      else
+        map = &m_default.kv();
+
+      if (!req.keys())
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVBitCount);
+      else
+      {
+        const auto stop = req.stop() ? req.stop() : std::numeric_limits<std::uint64_t>::max();
+
+        FlexBuilder flxb;
+        flxb.Map([&]
+        {
+          if (!map)
+            return;
+
+          for (const auto& key : *req.keys())
+          {
+            if (const auto bytes = map->blob(KeyView{key->string_view()}); bytes)
+              flxb.UInt(key->c_str(), bitmap::count(*bytes, req.start(), stop));
+          }
+        });
+        flxb.Finish();
+
+        const auto vec = fbb.CreateVector(flxb.GetBuffer());
+        const auto body = fc::response::CreateKVBitCount(fbb, vec);
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVBitCount, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVBitCount);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVBitOp& req) noexcept
+  {
+    try
+    {
+      CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+        map = &(*getOrCreateGroup(group->str()))->second.kv();
+      else
+        map = &m_default.kv();
+
+      if (!req.dest() || !req.keys() || !req.keys()->size())
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVBitOp);
+      else if (const auto count = map->bitOp(req.op(), KeyView{req.dest()->string_view()}, *req.keys()); !count)
+        createEmptyBodyResponse(fbb, map->isEncoded() ? Status_Fail : Status_NotPermitted, ResponseBody_KVBitOp);
+      else
+      {
+        const auto body = fc::response::CreateKVBitOp(fbb, *count);
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVBitOp, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVBitOp);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVHllAdd& req) noexcept
+  {
+    try
+    {
+      CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+        map = &(*getOrCreateGroup(group->str()))->second.kv();
+      else
+        map = &m_default.kv();
+
+      const KeyView key{req.key() ? req.key()->string_view() : std::string_view{}};
+
+      if (!req.items() || !req.items()->size())
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVHllAdd);
+      else if (map->version(key) && !map->hll(key))
+        createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVHllAdd);
+      else if (const auto updated = map->hllAdd(key, *req.items()); !updated)
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVHllAdd);
+      else
+      {
+        const auto body = fc::response::CreateKVHllAdd(fbb, *updated);
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVHllAdd, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVHllAdd);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVHllCount& req) noexcept
+  {
+    try
+    {
+      const CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+      {
+        if (const auto opt = getGroup(group->str()); opt)
+          map = &(*opt)->second.kv();
+      }
+      else
+        map = &m_default.kv();
+
+      if (!req.keys() || !req.keys()->size())
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVHllCount);
+      else
+      {
+        // no group is the same as keys which don't exist
+        const auto count = map ? map->hllCount(*req.keys()) : std::optional<std::uint64_t>{0};
+
+        if (!count)
+          createEmptyBodyResponse(fbb, Status_NotPermitted, ResponseBody_KVHllCount);
+        else
+        {
+          const auto body = fc::response::CreateKVHllCount(fbb, *count);
+          const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVHllCount, body.Union());
+          fbb.Finish(rsp);
+        }
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVHllCount);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVHllMerge& req) noexcept
+  {
+    try
+    {
+      CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+        map = &(*getOrCreateGroup(group->str()))->second.kv();
+      else
+        map = &m_default.kv();
+
+      if (!req.dest() || !req.keys() || !req.keys()->size())
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVHllMerge);
+      else if (const auto count = map->hllMerge(KeyView{req.dest()->string_view()}, *req.keys()); !count)
+        createEmptyBodyResponse(fbb, map->isEncoded() ? Status_Fail : Status_NotPermitted, ResponseBody_KVHllMerge);
+      else
+      {
+        const auto body = fc::response::CreateKVHllMerge(fbb, *count);
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVHllMerge, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVHllMerge);
+    }
+  }
+
+
+  void KvHandler::handle(FlatBuilder& fbb, const fc::request::KVNearest& req) noexcept
+  {
+    try
+    {
+      const CacheMap * map{nullptr};
+
+      if (const auto group = req.group(); group && !group->empty())
+      {
+        if (const auto opt = getGroup(group->str()); opt)
+          map = &(*opt)->second.kv();
+      }
+      else
+        map = &m_default.kv();
+
+      if (!req.query() || !req.query()->size() || !req.k() || req.metric() > fc::request::Metric_MAX)
+        createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVNearest);
+      else if (!map)
+        createEmptyBodyResponse(fbb, Status_NotExist, ResponseBody_KVNearest);
+      else
+      {
+        const std::span<const float> query {req.query()->data(), req.query()->size()};
+        const auto nearest = map->nearest(query, req.metric(), req.k(), req.threads(), m_workers);
+
+        std::vector<flatbuffers::Offset<flatbuffers::String>> keys;
+        std::vector<float> scores;
+        keys.reserve(nearest.size());
+        scores.reserve(nearest.size());
+
+        for (const auto& [key, score] : nearest)
+        {
+          keys.push_back(fbb.CreateString(key));
+          scores.push_back(score);
+        }
+
+        const auto keysVec = fbb.CreateVector(keys);
+        const auto scoresVec = fbb.CreateVector(scores);
+        const auto body = fc::response::CreateKVNearest(fbb, keysVec, scoresVec);
+        const auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_KVNearest, body.Union());
+        fbb.Finish(rsp);
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_KVNearest);
+    }
+  }
+
+
+  void KvHandler::defrag() noexcept
+  {
+    try
+    {
+      Group * target{nullptr};
+      std::size_t targetWaste{0}, skipped{0}, skippedWaste{0};
+
+      auto consider = [&](Group& group)
+      {
+        const auto used = group.bytesUsed();
+        const auto reserved = group.bytesReserved();
+        const auto waste = reserved > used ? reserved - used : 0U;
+
+        // an upload's value is in the group's memory, but isn't copied by compact()
+        if (group.hasUploads() || waste < DefragMinWaste || static_cast<double>(reserved) < static_cast<double>(used) * DefragRatio)
+          return;
+        else if (used > DefragMaxGroupBytes)
+        {
+          // fragmented, but too large to copy without stalling the event loop
+          ++skipped;
+          skippedWaste += waste;
+        }
+        else if (waste > targetWaste)
+        {
+          target = &group;
+          targetWaste = waste;
+        }
+      };
+
+      consider(m_default);
+      for (auto& group : m_groups)
+        consider(group.second);
+
+      if (skipped != m_defragSkipped)
+        PLOGI << "Defrag: " << skipped << " fragmented group(s) too large to compact, wasting " << skippedWaste << " bytes";
+
+      m_defragSkipped = skipped;
+      m_defragSkippedBytes = skippedWaste;
+
+      if (target)
+      {
+        const auto before = target->bytesReserved();
+
+        // previous memory released here rather than lazily, so it's 
+        // available to malloc_trim()
+        target->compact();
+
+        const auto after = target->bytesReserved();
+        m_defragReleased += before > after ? before - after : 0U;
+        ++m_defragRuns;
+
+        // return free pages to the OS
+        malloc_trim(0);
+
+        PLOGD << "Defrag: reserved before: " << before << ", after: " << after;
+      }
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+    }
+  }
+
+
+  void KvHandler::metrics(FlexBuilder& flxb) const
+  {
+    std::size_t used{m_default.bytesUsed()}, reserved{m_default.bytesReserved()};
+    std::size_t compressed{m_default.kv().compressedBytes()}, uncompressed{m_default.kv().uncompressedBytes()};
+    std::size_t rehashes{m_default.kv().rehashStats().count};
+    std::chrono::microseconds rehashMax{m_default.kv().rehashStats().max};
+
+    for (const auto& group : m_groups)
+    {
+      used += group.second.bytesUsed();
+      reserved += group.second.bytesReserved();
+      compressed += group.second.kv().compressedBytes();
+      uncompressed += group.second.kv().uncompressedBytes();
+      rehashes += group.second.kv().rehashStats().count;
+      rehashMax = std::max(rehashMax, group.second.kv().rehashStats().max);
+    }
+
+    flxb.UInt("kv_groups", m_groups.size());
+    flxb.UInt("kv_bytes_used", used);
+    flxb.UInt("kv_bytes_reserved", reserved);
+    flxb.Double("kv_fragmentation_ratio", used ? static_cast<double>(reserved) / static_cast<double>(used) : 0.0);
+    flxb.UInt("defrag_runs", m_defragRuns);
+    flxb.UInt("defrag_bytes_released", m_defragReleased);
+    flxb.UInt("defrag_skipped_groups", m_defragSkipped);
+    flxb.UInt("defrag_skipped_bytes", m_defragSkippedBytes);
+    flxb.UInt("kv_compressed_bytes", compressed);
+    flxb.UInt("kv_uncompressed_bytes", uncompressed);
+    flxb.Double("kv_compression_ratio", compressed ? static_cast<double>(uncompressed) / static_cast<double>(compressed) : 0.0);
+    flxb.UInt("kv_rehashes", rehashes);
+    flxb.UInt("kv_rehash_max_us", rehashMax.count());
+  }
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include <fc/LazyFree.hpp>
+#include <chrono>
+
+
+namespace fc
+{
+  LazyFree::LazyFree(const bool enabled) : m_enabled(enabled)
+  {
+    if (m_enabled)
+      m_thread = std::jthread{[this](std::stop_token stop){ run(stop); }};
+  }
+
+
+  void LazyFree::run (std::stop_token stop)
+  {
+    std::vector<std::shared_ptr<void>> items;
+
+    while (!stop.stop_requested())
+    {
+      {
+        std::unique_lock lock{m_mux};
+        if (!m_cv.wait(lock, stop, [this]{ return !m_pending.empty(); }))
+          break; // stop requested, anything pending is freed when m_pending is destroyed
+
+        items.swap(m_pending);
+      }
+
+      const auto start = std::chrono::steady_clock::now();
+
+      for (auto& item : items)
+      {
+        item.reset();
+        ++m_freed;
+      }
+
+      items.clear();
+
+      const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+      m_freeTimeUs += duration.count();
+    }
+  }
+
+
+  void LazyFree::metrics (FlexBuilder& flxb) const
+  {
+    const auto queued = m_queued.load();
+    const auto freed = m_freed.load();
+
+    flxb.Bool("lazy_free_enabled", m_enabled);
+    flxb.UInt("lazy_free_pending", queued - freed);
+    flxb.UInt("lazy_free_freed", freed);
+    flxb.UInt("lazy_free_time_us", m_freeTimeUs.load());
+  }
+}
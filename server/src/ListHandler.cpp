@@ -71,6 +71,7 @@ namespace fc
             case FlexType::FBT_VECTOR_KEY:
             {
               std::visit(makeSet(items, req.position()), fcList->list());
+              modified(*fcList);
             }
             break;
 
@@ -100,13 +101,19 @@ namespace fc
     {
       if (req.name()->empty())
       {
-        m_lists.clear();
+        m_lazyFree.release(std::exchange(m_lists, {}));
       }
       else
       {
         // if list doesn't exist, it's not an error
         for (const auto name : *req.name())
-          m_lists.erase(name->str());
+        {
+          if (auto it = m_lists.find(name->str()); it != m_lists.end())
+          {
+            m_lazyFree.release(std::move(it->second));
+            m_lists.erase(it);
+          }
+        }
       }    
     }
     catch(const std::exception& e)
@@ -133,21 +140,26 @@ namespace fc
       {
         const auto& fcList = (*listOpt)->second;
 
-        FlexBuilder flxb{4096U}; 
+        if (req.if_changed() && req.if_changed() == fcList->version())
+          createEmptyBodyResponse(fbb, Status_NotModified, ResponseBody_ListGetRange);
+        else
+        {
+          FlexBuilder flxb{4096U}; 
 
-        const bool createdBuffer = hasStop ?  std::visit(makeGetFullRange(flxb, start, stop, base), fcList->list()) :
-                                              std::visit(makeGetPartialRange(flxb, start, base), fcList->list());
+          const bool createdBuffer = hasStop ?  std::visit(makeGetFullRange(flxb, start, stop, base), fcList->list()) :
+                                                std::visit(makeGetPartialRange(flxb, start, base), fcList->list());
         
-        if (!createdBuffer)
-          flxb.TypedVector([]{}); // return empty vector
+          if (!createdBuffer)
+            flxb.TypedVector([]{}); // return empty vector
 
-        flxb.Finish();
+          flxb.Finish();
         
-        const auto vec = fbb.CreateVector(flxb.GetBuffer());
-        const auto body = fc::response::CreateListGetRange(fbb, vec);
+          const auto vec = fbb.CreateVector(flxb.GetBuffer());
+          const auto body = fc::response::CreateListGetRange(fbb, vec, fcList->listType(), fcList->version());
         
-        auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_ListGetRange, body.Union());
-        fbb.Finish(rsp);
+          auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_ListGetRange, body.Union());
+          fbb.Finish(rsp);
+        }
       }
     }
     catch(const std::exception& e)
@@ -177,6 +189,8 @@ namespace fc
           std::visit(makeRemoveFullRange(start, stop), fcList->list());
         else
           std::visit(makeRemovePartialRange(start), fcList->list());
+
+        modified(*fcList);
       }
     }
     catch(const std::exception& e)
@@ -234,6 +248,9 @@ namespace fc
         }
         break;
         }
+
+        if (size)
+          modified(*fcList);
       
         const auto body = fc::response::CreateListRemoveIf(fbb, size);
         const auto rsp = fc::response::CreateResponse (fbb, status, ResponseBody_ListRemoveIf, body.Union());
@@ -299,7 +316,7 @@ namespace fc
         
         const auto info = std::visit(Info{}, fcList->list());
 
-        const auto body = fc::response::CreateListInfo(fbb, info.size, fcList->listType(), fcList->isSorted());
+        const auto body = fc::response::CreateListInfo(fbb, info.size, fcList->listType(), fcList->isSorted(), info.memory);
         auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_ListInfo, body.Union());
         fbb.Finish(rsp);
       }
@@ -321,7 +338,9 @@ namespace fc
   {
     auto create = [this, sorted, &name](auto&& list) -> fc::response::Status
     {
-      const auto [_, created] = m_lists.try_emplace(name, std::make_unique<FcList>(std::forward<decltype(list)>(list), sorted));
+      const auto [it, created] = m_lists.try_emplace(name, std::make_unique<FcList>(std::forward<decltype(list)>(list), sorted));
+      if (created)
+        modified(*it->second);
       return created ? Status_Ok : Status_Duplicate;      
     };
 
@@ -379,6 +398,8 @@ namespace fc
           break;
         }      
 
+        modified(*fcList);
+
         if (isAppend)
         {
           const auto body = fc::response::CreateListAppend(fbb, size);
@@ -425,6 +446,8 @@ namespace fc
             intersect<ListT>(newList, l1, l2, range1, range2);                  
           },
           newList);
+
+          modified(*(*newListOpt)->second);
         }
       }
       
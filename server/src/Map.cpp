@@ -1,22 +1,108 @@
 #include <fc/Map.hpp>
 #include <fc/Common.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
 
 namespace fc
 {
   template<typename T>
-  static void toTypedVector(FlexBuilder& fb, const char * key, const VectorValue& vv)
+  static void toTypedVector(FlexBuilder& fb, const char * key, const VectorValue& vv, const std::size_t begin, const std::size_t end)
   {
-    fb.TypedVector(key, [&data = vv.data, &fb]
+    // the elements are stored as an array of T, so can be written in bulk if suitably aligned
+    if (const auto p = vv.data.data() + begin*sizeof(T); reinterpret_cast<std::uintptr_t>(p) % alignof(T) == 0)
+    {
+      addTypedVector(fb, key, reinterpret_cast<const T *>(p), end - begin);
+      return;
+    }
+
+    fb.TypedVector(key, [&data = vv.data, &fb, begin, end]
     {
-      for (std::size_t i = 0 ; i < data.size() ; i += sizeof(T))
+      for (std::size_t i = begin ; i < end ; ++i)
       {
         T v{};
-        std::memcpy(&v, data.data()+i, sizeof(T));
+        std::memcpy(&v, data.data() + i*sizeof(T), sizeof(T));
         fb.Add(v);
       }
     });
   }
 
+
+  // Converts a [start, stop) slice to indices, as ListGetRange does. Returns false if start is out of bounds.
+  static bool sliceToIndices (const flexbuffers::Reference& slice, const std::size_t size, std::size_t& begin, std::size_t& end)
+  {
+    const auto ssize = static_cast<std::int64_t>(size);
+    std::int64_t start{0}, stop{ssize};
+
+    // [start] or [start, stop], as a typed or untyped vector
+    const auto read = [&start, &stop](const auto& range)
+    {
+      if (range.size() > 0)
+        start = range[0].AsInt64();
+      if (range.size() > 1)
+        stop = range[1].AsInt64();
+      return range.size() > 0;
+    };
+
+    if (!(slice.IsTypedVector() ? read(slice.AsTypedVector()) : read(slice.AsVector())))
+      return false;
+
+    // not std::abs(), which is undefined for INT64_MIN
+    if (start >= ssize || start < -ssize)
+      return false;
+
+    begin = start < 0 ? ssize + start : start;
+    end = stop < 0 ? std::max<std::int64_t>(0, ssize + stop) : std::min<std::int64_t>(ssize, stop);
+    end = std::max(begin, end);
+    return true;
+  }
+
+
+  // Glob match with * (zero or more characters) and ? (one character)
+  static bool globMatch (const std::string_view pattern, const std::string_view str) noexcept
+  {
+    std::size_t p{0}, s{0};
+    std::size_t starP{std::string_view::npos}, starS{0};
+
+    while (s < str.size())
+    {
+      if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == str[s]))
+      {
+        ++p;
+        ++s;
+      }
+      else if (p < pattern.size() && pattern[p] == '*')
+      {
+        // record position of *, initially matching nothing
+        starP = p++;
+        starS = s;
+      }
+      else if (starP != std::string_view::npos)
+      {
+        // mismatch, so the last * matches one more character
+        p = starP + 1;
+        s = ++starS;
+      }
+      else
+        return false;
+    }
+
+    while (p < pattern.size() && pattern[p] == '*')
+      ++p;
+
+    return p == pattern.size();
+  }
+
+
+  template<typename T>
+  static void toTypedVector(FlexBuilder& fb, const char * key, const VectorValue& vv)
+  {
+    toTypedVector<T>(fb, key, vv, 0, vv.data.size() / sizeof(T));
+  }
+
   
   void CacheMap::extractInt(FlexBuilder& fb, const char * key, const FixedValue& fv)
   {
@@ -100,4 +186,1317 @@ namespace fc
   {
     toTypedVector<fcbool>(fb, key, vv);
   }
-}
\ No newline at end of file
+
+
+  void CacheMap::extractEncoded(FlexBuilder& fb, const char * key, const VectorValue& vv)
+  {
+    fb.Blob(key, vv.data.data(), vv.data.size());
+  }
+
+
+  void CacheMap::encodedToMap (const Map::iterator it, const flexbuffers::Reference& value)
+  {
+    FlexBuilder encoder;
+
+    // same element types as the extract functions use for the value when not encoded
+    const auto encodeScalars = [&encoder]<typename ScalarT>(const flexbuffers::TypedVector& v, const ScalarT)
+    {
+      encoder.TypedVector([&]
+      {
+        for (std::size_t i = 0 ; i < v.size() ; ++i)
+          encoder.Add(v[i].As<ScalarT>());
+      });
+    };
+
+    switch (value.GetType())
+    {
+      case FBT_STRING:
+      {
+        const auto str = value.AsString();
+        encoder.String(str.c_str(), str.length());
+      }
+      break;
+
+      case FBT_BLOB:
+      {
+        const auto blob = value.AsBlob();
+        encoder.Blob(blob.data(), blob.size());
+      }
+      break;
+
+      case FBT_VECTOR_INT:
+        encodeScalars(value.AsTypedVector(), fcint{});
+      break;
+
+      case FBT_VECTOR_UINT:
+        encodeScalars(value.AsTypedVector(), fcuint{});
+      break;
+
+      case FBT_VECTOR_FLOAT:
+        encodeScalars(value.AsTypedVector(), fcfloat{});
+      break;
+
+      case FBT_VECTOR_BOOL:
+        encodeScalars(value.AsTypedVector(), fcbool{});
+      break;
+
+      case FBT_VECTOR_KEY:
+      {
+        const auto strings = value.AsTypedVector();
+        encoder.TypedVector([&]
+        {
+          for (std::size_t i = 0 ; i < strings.size() ; ++i)
+          {
+            const auto str = strings[i].AsString();
+            encoder.String(str.c_str(), str.length());
+          }
+        });
+      }
+      break;
+
+      default:
+        throw std::invalid_argument{"unsupported type for encoded value"};
+    }
+
+    encoder.Finish();
+
+    const auto& buffer = encoder.GetBuffer();
+
+    auto& vec = std::get<CachedValue::VEC>(it->second.value);
+    vec.type = value.GetType();
+    vec.extract = extractEncoded;
+    vec.data.assign(buffer.cbegin(), buffer.cend());
+  }
+
+  
+  // A buffer for compressing and decompressing. The event loop is single threaded, so one buffer is
+  // reused rather than allocating for every value, but it isn't kept larger than MaxKept after use:
+  // it's outside the groups' memory, so a large value would otherwise hold memory that isn't reported.
+  class CompressScratch
+  {
+  public:
+    explicit CompressScratch (const std::size_t size) : m_buffer(buffer())
+    {
+      m_buffer.resize(size);
+    }
+
+    ~CompressScratch()
+    {
+      if (m_buffer.capacity() > MaxKept)
+        std::vector<std::uint8_t>{}.swap(m_buffer);
+    }
+
+    std::uint8_t * data() noexcept { return m_buffer.data(); }
+    std::size_t size() const noexcept { return m_buffer.size(); }
+
+  private:
+    static constexpr std::size_t MaxKept = 1024U * 1024U;
+
+    static std::vector<std::uint8_t>& buffer() noexcept
+    {
+      static std::vector<std::uint8_t> buffer;
+      return buffer;
+    }
+
+    std::vector<std::uint8_t>& m_buffer;
+  };
+
+
+  void CacheMap::extractCompressed(FlexBuilder& fb, const char * key, const VectorValue& vv)
+  {
+    fcblobsize size{0};
+    std::memcpy(&size, vv.data.data(), sizeof(fcblobsize));
+
+    CompressScratch buffer{size};
+
+    uLongf destSize = size;
+    if (uncompress(buffer.data(), &destSize, vv.data.data() + sizeof(fcblobsize), vv.data.size() - sizeof(fcblobsize)) != Z_OK || destSize != size)
+      throw std::runtime_error{"decompress failed"};
+
+    if (vv.type == FBT_STRING)
+      fb.String(key, reinterpret_cast<const char *>(buffer.data()), size);
+    else
+      fb.Blob(key, buffer.data(), size);
+  }
+
+
+  bool CacheMap::compressToMap (const Map::iterator it, const FlexType type, const void * data, const std::size_t size)
+  {
+    if (size > std::numeric_limits<fcblobsize>::max())
+      return false;
+
+    CompressScratch buffer{compressBound(size)};
+
+    uLongf compressedSize = buffer.size();
+    if (compress2(buffer.data(), &compressedSize, static_cast<const Bytef *>(data), size, Z_BEST_SPEED) != Z_OK)
+      return false;
+
+    // not worth it if it doesn't save at least the header
+    if (compressedSize + sizeof(fcblobsize) >= size)
+      return false;
+
+    const fcblobsize uncompressedSize = static_cast<fcblobsize>(size);
+
+    auto& vec = std::get<CachedValue::VEC>(it->second.value);
+    vec.type = type;
+    vec.extract = extractCompressed;
+    vec.data.resize(sizeof(fcblobsize) + compressedSize);
+    std::memcpy(vec.data.data(), &uncompressedSize, sizeof(fcblobsize));
+    std::memcpy(vec.data.data() + sizeof(fcblobsize), buffer.data(), compressedSize);
+
+    m_compressedBytes += vec.data.size();
+    m_uncompressedBytes += size;
+    return true;
+  }
+
+
+  std::optional<std::span<const std::uint8_t>> CacheMap::blob (const KeyView& key) const noexcept
+  {
+    if (const auto it = m_map.find(key); it == m_map.cend() || it->second.valueType != CachedValue::VEC)
+      return {};
+    else if (const auto& vec = std::get<VectorValue>(it->second.value); vec.type != FBT_BLOB || isCompressedValue(vec))
+      return {};
+    else if (isEncodedValue(vec))
+    {
+      const auto blob = flexbuffers::GetRoot(vec.data.data(), vec.data.size()).AsBlob();
+      return std::span<const std::uint8_t>{blob.data(), blob.size()};
+    }
+    else
+      return std::span<const std::uint8_t>{vec.data.data() + sizeof(fcblobsize), valueSize(vec)};
+  }
+
+
+  std::optional<std::size_t> CacheMap::append (const KeyView& key, const flexbuffers::Reference& value, const std::size_t maxSize)
+  {
+    if (const auto it = m_map.find(key) ; it == m_map.end())
+      return writeAt(key, 0, value, maxSize);
+    else if (it->second.valueType != CachedValue::VEC)
+      return {};
+    else
+    {
+      auto& vec = std::get<VectorValue>(it->second.value);
+
+      if (!isCompatible(vec, value.GetType()) || isHllValue(vec) || exceedsMaxSize(vec, valueSize(vec), value, maxSize))
+        return {};
+      
+      write(vec, valueSize(vec), value);
+      it->second.modified();
+      return valueSize(vec);
+    }
+  }
+
+
+  std::optional<std::size_t> CacheMap::writeAt (const KeyView& key, const std::size_t offset, const flexbuffers::Reference& value, const std::size_t maxSize)
+  {
+    if (const auto it = m_map.find(key) ; it == m_map.end())
+    {
+      // only string, blob or vector values, which are all stored as a VectorValue
+      if (offset != 0 || (!value.IsString() && !value.IsBlob() && !value.IsTypedVector()))
+        return {};
+      else if (!setOrAdd<true>(key, value))
+        return {};
+      else
+        return valueSize(std::get<VectorValue>(m_map.find(key)->second.value));
+    }
+    else if (it->second.valueType != CachedValue::VEC)
+      return {};
+    else
+    {
+      auto& vec = std::get<VectorValue>(it->second.value);
+
+      if (!isCompatible(vec, value.GetType()) || isHllValue(vec) || offset > valueSize(vec) || exceedsMaxSize(vec, offset, value, maxSize))
+        return {};
+
+      write(vec, offset, value);
+      it->second.modified();
+      return valueSize(vec);
+    }
+  }
+
+
+  std::size_t CacheMap::valueSize (const VectorValue& vec) noexcept
+  {
+    if (isCompressedValue(vec))
+    {
+      fcblobsize size{0};
+      std::memcpy(&size, vec.data.data(), sizeof(fcblobsize));
+      return size;
+    }
+    else if (isEncodedValue(vec))
+    {
+      const auto root = flexbuffers::GetRoot(vec.data.data(), vec.data.size());
+
+      if (root.IsString())
+        return root.AsString().length();
+      else if (root.IsBlob())
+        return root.AsBlob().size();
+      else
+        return root.AsTypedVector().size();
+    }
+
+    switch (vec.type)
+    {
+      case FBT_STRING:
+        return vec.data.size() - 1; // '\0'
+
+      case FBT_BLOB:
+      {
+        fcblobsize size{0};
+        std::memcpy(&size, vec.data.data(), sizeof(fcblobsize));
+        return size;
+      }
+
+      case FBT_VECTOR_INT:
+        return vec.data.size() / sizeof(fcint);
+
+      case FBT_VECTOR_UINT:
+        return vec.data.size() / sizeof(fcuint);
+
+      case FBT_VECTOR_FLOAT:
+        return vec.data.size() / sizeof(fcfloat);
+
+      case FBT_VECTOR_BOOL:
+        return vec.data.size() / sizeof(fcbool);
+
+      case FBT_VECTOR_KEY:
+        return std::count(vec.data.cbegin(), vec.data.cend(), '\0');
+
+      default:
+        return 0;
+    }
+  }
+
+
+  std::size_t CacheMap::valueSize (const CachedValue& cv) noexcept
+  {
+    if (cv.valueType == CachedValue::VEC)
+      return valueSize(std::get<VectorValue>(cv.value));
+    else if (cv.valueType == CachedValue::HASH)
+      return std::get<HashValue>(cv.value).fields.size();
+    else
+      return 1U;
+  }
+
+
+  bool CacheMap::isFieldMap (const flexbuffers::Map& fields) noexcept
+  {
+    const auto values = fields.Values();
+
+    for (std::size_t i = 0 ; i < values.size() ; ++i)
+    {
+      switch (values[i].GetType())
+      {
+        case FBT_INT:
+        case FBT_UINT:
+        case FBT_FLOAT:
+        case FBT_BOOL:
+        case FBT_STRING:
+          break;
+
+        default:
+          return false;
+      }
+    }
+    return true;
+  }
+
+
+  void CacheMap::writeFields (HashValue& hash, const flexbuffers::Map& fields)
+  {
+    const auto names = fields.Keys();
+    const auto values = fields.Values();
+
+    for (std::size_t i = 0 ; i < names.size() ; ++i)
+      writeField(hash.get(names[i].AsKey()), values[i]);
+  }
+
+
+  void CacheMap::writeField (HashField& field, const flexbuffers::Reference& value)
+  {
+    switch (value.GetType())
+    {
+      case FBT_INT:
+        field.value.emplace<fcint>(value.AsInt64());
+      break;
+
+      case FBT_UINT:
+        field.value.emplace<fcuint>(value.AsUInt64());
+      break;
+
+      case FBT_FLOAT:
+        field.value.emplace<fcfloat>(value.AsFloat());
+      break;
+
+      case FBT_BOOL:
+        field.value.emplace<fcbool>(value.AsBool());
+      break;
+
+      case FBT_STRING:
+      {
+        const auto str = value.AsString();
+
+        // an existing string's allocation is reused if it has capacity
+        if (auto current = std::get_if<std::pmr::string>(&field.value); current)
+          current->assign(str.c_str(), str.length());
+        else
+          field.value.emplace<std::pmr::string>(str.c_str(), str.length(), field.name.get_allocator());
+      }
+      break;
+
+      default:
+        throw std::invalid_argument{"unsupported type for hash field"};
+    }
+  }
+
+
+  void CacheMap::addField (FlexBuilder& fb, const char * name, const HashField::Value& value)
+  {
+    std::visit([&fb, name](const auto& v)
+    {
+      using T = std::decay_t<decltype(v)>;
+
+      if constexpr (std::is_same_v<T, std::pmr::string>)
+      {
+        fb.Key(name);
+        fb.String(v.data(), v.size());
+      }
+      else
+        fb.Add(name, v);
+    },
+    value);
+  }
+
+
+  void CacheMap::getFields (FlexBuilder& fb, const HashValue& hash, const KeyVector * names)
+  {
+    if (names && names->size())
+    {
+      for (const auto& name : *names)
+      {
+        if (const auto field = hash.find(name->string_view()); field)
+          addField(fb, name->c_str(), field->value);
+      }
+    }
+    else
+    {
+      for (const auto& field : hash.fields)
+        addField(fb, field.name.c_str(), field.value);
+    }
+  }
+
+
+  bool CacheMap::setFields (const KeyView& key, const flexbuffers::Map& fields)
+  {
+    if (!isFieldMap(fields))
+      return false;
+
+    auto [it, created] = tryEmplace(key, HashValue{});
+
+    if (!created && it->second.valueType != CachedValue::HASH)
+      return false;
+
+    writeFields(std::get<HashValue>(it->second.value), fields);
+
+    if (!created)
+      it->second.modified();
+
+    return true;
+  }
+
+
+  bool CacheMap::addFields (const KeyView& key, const flexbuffers::Map& amounts, FlexBuilder& fb)
+  {
+    const auto names = amounts.Keys();
+    const auto values = amounts.Values();
+
+    auto it = m_map.find(key);
+
+    if (it != m_map.end() && it->second.valueType != CachedValue::HASH)
+      return false;
+
+    // check everything before changing anything, so a fail leaves the hash unchanged
+    for (std::size_t i = 0 ; i < names.size() ; ++i)
+    {
+      if (!values[i].IsNumeric())
+        return false;
+      else if (it != m_map.end())
+      {
+        const auto field = std::get<HashValue>(it->second.value).find(names[i].AsKey());
+
+        if (field && !std::holds_alternative<fcint>(field->value) && !std::holds_alternative<fcuint>(field->value) && !std::holds_alternative<fcfloat>(field->value))
+          return false;
+      }
+    }
+
+    const bool created = it == m_map.end();
+    if (created)
+      it = tryEmplace(key, HashValue{}).first;
+
+    auto& hash = std::get<HashValue>(it->second.value);
+
+    for (std::size_t i = 0 ; i < names.size() ; ++i)
+    {
+      const auto name = names[i].AsKey();
+      const auto amount = values[i];
+
+      auto field = hash.find(name);
+
+      if (!field)
+      {
+        // new field is the amount
+        field = &hash.fields.emplace_back(name);
+
+        if (amount.IsFloat())
+          field->value.emplace<fcfloat>(0);
+      }
+
+      if (auto pInt = std::get_if<fcint>(&field->value); pInt)
+        *pInt = saturatingAdd(*pInt, amount.AsInt64());
+      else if (auto pUInt = std::get_if<fcuint>(&field->value); pUInt)
+        *pUInt = saturatingAdd(*pUInt, amount.AsInt64());
+      else if (auto pFloat = std::get_if<fcfloat>(&field->value); pFloat)
+        *pFloat += amount.AsFloat();
+
+      addField(fb, name, field->value);
+    }
+
+    if (!created)
+      it->second.modified();
+
+    return true;
+  }
+
+
+  std::optional<std::uint64_t> CacheMap::setBits (const KeyView& key, const flatbuffers::Vector<std::uint64_t>& bits, const bool value)
+  {
+    if (m_options.encoded || !bits.size())
+      return {};
+
+    const auto maxBit = *std::max_element(bits.cbegin(), bits.cend());
+
+    if (maxBit >= bitmap::MaxBits)
+      return {};
+
+    if (const auto it = m_map.find(key); it != m_map.end())
+    {
+      if (it->second.valueType != CachedValue::VEC)
+        return {};
+      else if (const auto& vec = std::get<VectorValue>(it->second.value); vec.type != FBT_BLOB || isCompressedValue(vec) || isHllValue(vec))
+        return {};
+    }
+
+    auto [it, created] = tryEmplace(key, VectorValue{});
+    auto& vec = std::get<VectorValue>(it->second.value);
+
+    if (created)
+    {
+      vec.type = FBT_BLOB;
+      vec.extract = extractBlob;
+    }
+
+    // extended with zeroes to include the highest bit
+    if (const std::size_t required = maxBit/8 + 1; created || required > valueSize(vec))
+    {
+      const auto size = static_cast<fcblobsize>(required);
+      vec.data.resize(sizeof(fcblobsize) + size);
+      std::memcpy(vec.data.data(), &size, sizeof(fcblobsize));
+    }
+
+    const auto data = vec.data.data() + sizeof(fcblobsize);
+    std::uint64_t changed{0};
+
+    for (const auto bit : bits)
+    {
+      const std::uint8_t mask = 1U << (bit % 8);
+      auto& byte = data[bit / 8];
+
+      if (static_cast<bool>(byte & mask) != value)
+      {
+        byte ^= mask;
+        ++changed;
+      }
+    }
+
+    if (changed && !created)
+      it->second.modified();
+
+    return changed;
+  }
+
+
+  std::optional<std::uint64_t> CacheMap::bitOp (const fc::request::BitOp op, const KeyView& dest, const KeyVector& keys)
+  {
+    using enum fc::request::BitOp;
+
+    if (m_options.encoded)
+      return {};
+
+    // a HyperLogLog isn't replaced with a bitmap
+    if (hll(dest))
+      return {};
+
+    // dest may be one of the keys, so the result is built before dest is replaced
+    std::vector<std::span<const std::uint8_t>> sources;
+    sources.reserve(keys.size());
+
+    std::size_t size{0};
+
+    for (const auto& key : keys)
+    {
+      const KeyView keyView{key->string_view()};
+
+      if (const auto bits = blob(keyView); bits && hll::isHll(*bits))
+        return {};
+      else if (bits)
+      {
+        sources.push_back(*bits);
+        size = std::max(size, bits->size());
+      }
+      else if (m_map.contains(keyView))
+        return {};
+      else
+        sources.emplace_back();
+    }
+
+    VectorValue result {VectorValue::allocator_type{m_map.get_allocator().resource()}};
+    result.data.resize(sizeof(fcblobsize) + size);
+
+    const auto blobSize = static_cast<fcblobsize>(size);
+    std::memcpy(result.data.data(), &blobSize, sizeof(fcblobsize));
+
+    const auto data = result.data.data() + sizeof(fcblobsize);
+
+    if (!sources.empty())
+    {
+      std::copy(sources[0].begin(), sources[0].end(), data);
+
+      for (std::size_t i = 1 ; i < sources.size() ; ++i)
+      {
+        const auto& src = sources[i];
+
+        switch (op)
+        {
+          case BitOp_And:
+            bitmap::apply<BitOp_And>(data, src.data(), src.size());
+            std::fill(data + src.size(), data + size, std::uint8_t{0}); // beyond src is 0
+          break;
+
+          case BitOp_Or:
+            bitmap::apply<BitOp_Or>(data, src.data(), src.size());
+          break;
+
+          case BitOp_Xor:
+            bitmap::apply<BitOp_Xor>(data, src.data(), src.size());
+          break;
+
+          case BitOp_AndNot:
+            bitmap::apply<BitOp_AndNot>(data, src.data(), src.size());
+          break;
+        }
+      }
+    }
+
+    const auto count = bitmap::count(data, size);
+    setBlob(dest, std::move(result));
+    return count;
+  }
+
+
+  std::optional<bool> CacheMap::hllAdd (const KeyView& key, const KeyVector& items)
+  {
+    if (m_options.encoded || (m_map.contains(key) && !hll(key)))
+      return {};
+
+    auto [it, created] = tryEmplace(key, VectorValue{});
+    auto& vec = std::get<VectorValue>(it->second.value);
+
+    if (created)
+    {
+      vec.type = FBT_BLOB;
+      vec.extract = extractBlob;
+      hll::init(vec.data, sizeof(fcblobsize));
+    }
+
+    bool updated{false};
+
+    for (const auto& item : items)
+      updated |= hll::add(vec.data, sizeof(fcblobsize), ankerl::unordered_dense::hash<std::string_view>{}(item->string_view()));
+
+    // the sparse encoding grows, and may become dense
+    const auto size = static_cast<fcblobsize>(vec.data.size() - sizeof(fcblobsize));
+    std::memcpy(vec.data.data(), &size, sizeof(fcblobsize));
+
+    if (updated && !created)
+      it->second.modified();
+
+    return updated;
+  }
+
+
+  bool CacheMap::hllRegisters (const KeyVector& keys, hll::Registers& registers) const
+  {
+    for (const auto& key : keys)
+    {
+      const KeyView keyView{key->string_view()};
+
+      if (const auto bytes = hll(keyView); bytes)
+        hll::merge(*bytes, registers);
+      else if (m_map.contains(keyView))
+        return false;
+    }
+
+    return true;
+  }
+
+
+  std::optional<std::uint64_t> CacheMap::hllCount (const KeyVector& keys) const
+  {
+    hll::Registers registers{};
+
+    if (!hllRegisters(keys, registers))
+      return {};
+    else
+      return hll::count(registers);
+  }
+
+
+  std::optional<std::uint64_t> CacheMap::hllMerge (const KeyView& dest, const KeyVector& keys)
+  {
+    hll::Registers registers{};
+
+    if (m_options.encoded || !hllRegisters(keys, registers))
+      return {};
+
+    VectorValue result {VectorValue::allocator_type{m_map.get_allocator().resource()}};
+    hll::store(result.data, sizeof(fcblobsize), registers);
+
+    const auto size = static_cast<fcblobsize>(result.data.size() - sizeof(fcblobsize));
+    std::memcpy(result.data.data(), &size, sizeof(fcblobsize));
+
+    setBlob(dest, std::move(result));
+    return hll::count(registers);
+  }
+
+
+  template<fc::request::Metric M>
+  void CacheMap::nearestScan (const std::span<const float> query, const float queryNorm, const std::size_t begin, const std::size_t end,
+                              similarity::TopK& topK) const noexcept
+  {
+    const auto& values = m_map.values();
+
+    for (auto i = begin ; i < end ; ++i)
+    {
+      if (const auto& cv = values[i].second; cv.valueType == CachedValue::VEC)
+      {
+        // an encoded value is a flexbuffer, so its floats aren't in place
+        if (const auto& vv = std::get<VectorValue>(cv.value);
+            vv.type == FBT_VECTOR_FLOAT && !isEncodedValue(vv) && vv.data.size() == query.size_bytes())
+        {
+          if (const auto rank = similarity::rank<M>(vv.data.data(), query, queryNorm); !std::isnan(rank))
+            topK.push({rank, i});
+        }
+      }
+    }
+  }
+
+
+  std::vector<std::pair<std::string_view, float>> CacheMap::nearest (const std::span<const float> query, const fc::request::Metric metric,
+                                                                     std::size_t k, const std::size_t threads, WorkerPool& workers) const
+  {
+    using enum fc::request::Metric;
+
+    // a shard is only given to another thread if it's large enough to amortise the handoff
+    constexpr std::size_t ShardMinSize = 16384U;
+
+    const auto size = m_map.values().size();
+
+    if (size == 0)
+      return {};
+
+    // k is from the request, so don't reserve heaps larger than the map
+    k = std::min<std::size_t>(k, size);
+
+    const auto maxShards = std::min<std::size_t>({threads, size / ShardMinSize, workers.size()});
+    const auto shards = std::max<std::size_t>(maxShards, 1U);
+
+    float queryNorm{0};
+    for (const auto q : query)
+      queryNorm += q * q;
+    queryNorm = std::sqrt(queryNorm);
+
+    // each shard's heap is reserved here, so scanning doesn't allocate
+    std::vector<similarity::TopK> results;
+    results.reserve(shards);
+    for (std::size_t s = 0 ; s < shards ; ++s)
+      results.emplace_back(k);
+
+    // the map is only read, and the event loop thread waits for the workers
+    workers.run(shards, [&](const std::size_t shard) noexcept
+    {
+      const auto begin = size * shard / shards;
+      const auto end = size * (shard + 1) / shards;
+
+      switch (metric)
+      {
+        case Metric_Dot:
+          nearestScan<Metric_Dot>(query, queryNorm, begin, end, results[shard]);
+        break;
+
+        case Metric_Cosine:
+          nearestScan<Metric_Cosine>(query, queryNorm, begin, end, results[shard]);
+        break;
+
+        case Metric_L2:
+          nearestScan<Metric_L2>(query, queryNorm, begin, end, results[shard]);
+        break;
+      }
+    });
+
+    for (std::size_t s = 1 ; s < shards ; ++s)
+      results[0].merge(results[s]);
+
+    std::vector<std::pair<std::string_view, float>> nearest;
+    for (const auto& candidate : results[0].sorted())
+      nearest.emplace_back(m_map.values()[candidate.index].first.view(), similarity::score(metric, candidate.rank));
+
+    return nearest;
+  }
+
+
+  bool CacheMap::isCompatible (const VectorValue& vec, const FlexType incoming) noexcept
+  {
+    if (isEncodedValue(vec) || isCompressedValue(vec))
+      return false;
+
+    switch (vec.type)
+    {
+      case FBT_VECTOR_INT:
+      case FBT_VECTOR_UINT:
+        return incoming == FBT_VECTOR_INT || incoming == FBT_VECTOR_UINT;
+
+      case FBT_STRING:
+      case FBT_BLOB:
+      case FBT_VECTOR_FLOAT:
+      case FBT_VECTOR_BOOL:
+      case FBT_VECTOR_KEY:
+        return incoming == vec.type;
+
+      default:
+        return false;
+    }
+  }
+
+
+  bool CacheMap::exceedsMaxSize (const VectorValue& vec, const std::size_t offset, const flexbuffers::Reference& value, const std::size_t maxSize) noexcept
+  {
+    const auto limit = std::min<std::size_t>(maxSize, std::numeric_limits<fcblobsize>::max());
+
+    if (vec.type == FBT_STRING)
+      return offset + value.AsString().length() > limit;
+    else if (vec.type == FBT_BLOB)
+      return offset + value.AsBlob().size() > limit;
+    else
+      return false;
+  }
+
+
+  void CacheMap::write (VectorValue& vec, const std::size_t offset, const flexbuffers::Reference& value)
+  {
+    switch (vec.type)
+    {
+      case FBT_STRING:
+      {
+        const auto str = value.AsString();
+        writeBytes(vec, offset, str.c_str(), str.length());
+      }
+      break;
+
+      case FBT_BLOB:
+      {
+        const auto blob = value.AsBlob();
+        writeBytes(vec, offset, blob.data(), blob.size());
+      }
+      break;
+
+      case FBT_VECTOR_INT:
+        writeScalars<fcint>(vec, offset, value.AsTypedVector());
+      break;
+
+      case FBT_VECTOR_UINT:
+        writeScalars<fcuint>(vec, offset, value.AsTypedVector());
+      break;
+
+      case FBT_VECTOR_FLOAT:
+        writeScalars<fcfloat>(vec, offset, value.AsTypedVector());
+      break;
+
+      case FBT_VECTOR_BOOL:
+        writeScalars<fcbool>(vec, offset, value.AsTypedVector());
+      break;
+
+      case FBT_VECTOR_KEY:
+        writeStrings(vec, offset, value.AsTypedVector());
+      break;
+
+      default:
+      break;
+    }
+  }
+
+
+  void CacheMap::writeBytes (VectorValue& vec, const std::size_t offset, const void * src, const std::size_t size)
+  {
+    const auto currentSize = valueSize(vec);
+    const auto newSize = std::max(currentSize, offset + size);
+
+    if (vec.type == FBT_STRING)
+    {
+      // [chars]['\0']
+      vec.data.resize(newSize + 1);
+      std::memcpy(vec.data.data() + offset, src, size);
+      vec.data[newSize] = '\0';
+    }
+    else
+    {
+      // [fcblobsize][data]
+      const auto blobSize = static_cast<fcblobsize>(newSize);
+
+      vec.data.resize(sizeof(fcblobsize) + newSize);
+      std::memcpy(vec.data.data() + sizeof(fcblobsize) + offset, src, size);
+      std::memcpy(vec.data.data(), &blobSize, sizeof(fcblobsize));
+    }
+  }
+
+
+  void CacheMap::writeStrings (VectorValue& vec, const std::size_t index, const flexbuffers::TypedVector& strings)
+  {
+    // strings are null delimited, so the strings being replaced are found by scanning, then
+    // the bytes after them are moved to fit the new strings
+
+    auto& data = vec.data;
+
+    const auto skip = [&data](std::size_t pos, std::size_t count)
+    {
+      for ( ; pos < data.size() && count ; --count)
+        pos += std::strlen(reinterpret_cast<const char *>(data.data()) + pos) + 1;
+      return pos;
+    };
+
+    const auto start = skip(0, index);
+    const auto end = skip(start, strings.size());
+    
+    std::size_t newBytes{0};
+    for (std::size_t s = 0 ; s < strings.size() ; ++s)
+      newBytes += strings[s].AsString().length() + 1;
+
+    const auto oldBytes = end - start;
+    const auto tailBytes = data.size() - end;
+
+    if (newBytes > oldBytes)
+    {
+      data.resize(data.size() + (newBytes - oldBytes));
+      std::memmove(data.data() + start + newBytes, data.data() + end, tailBytes);
+    }
+    else if (newBytes < oldBytes)
+    {
+      std::memmove(data.data() + start + newBytes, data.data() + end, tailBytes);
+      data.resize(data.size() - (oldBytes - newBytes));
+    }
+
+    for (std::size_t s = 0, dest = start ; s < strings.size() ; ++s)
+    {
+      const auto str = strings[s].AsString();
+      std::memcpy(data.data() + dest, str.c_str(), str.length());
+      dest += str.length();
+      data[dest++] = '\0';
+    }
+  }
+
+
+  void CacheMap::get (const KeyVector& keys, FlexBuilder& fb, const flexbuffers::Map& slices) const
+  {
+    fb.Map([&]
+    {
+      for (const auto& key : keys)
+      { 
+        if (const auto& it = m_map.find(KeyView{key->string_view()}); it != m_map.cend())
+        {
+          const auto pKey = key->c_str();
+          const auto& cachedValue = it->second;
+
+          if (cachedValue.valueType == CachedValue::VEC)
+          {
+            const auto& vecValue = std::get<VectorValue>(cachedValue.value);
+
+            if (const auto slice = slices[pKey]; slice.IsNull())
+              vecValue.extract(fb, pKey, vecValue);
+            else
+              extractSlice(fb, pKey, vecValue, slice);
+          }
+          else
+            extract(fb, pKey, cachedValue);
+        }
+      }
+    });
+  }
+
+
+  void CacheMap::sizes (const KeyVector& keys, FlexBuilder& fb) const
+  {
+    fb.Map([&]
+    {
+      for (const auto& key : keys)
+      {
+        if (const auto& it = m_map.find(KeyView{key->string_view()}); it != m_map.cend())
+          fb.UInt(key->c_str(), valueSize(it->second));
+      }
+    });
+  }
+
+
+  void CacheMap::sizes (FlexBuilder& fb) const
+  {
+    fb.Map([&]
+    {
+      for (const auto& [key, cachedValue] : m_map)
+        fb.UInt(key.c_str(), valueSize(cachedValue));
+    });
+  }
+
+
+  void CacheMap::valueInfo (FlexBuilder& fb, const char * key, const CachedValue& cv)
+  {
+    FlexType type;
+    std::size_t size{1}, bytes{0};
+
+    if (cv.valueType == CachedValue::VEC)
+    {
+      const auto& vec = std::get<VectorValue>(cv.value);
+      type = vec.type;
+      size = valueSize(vec);
+      bytes = vec.data.size();
+    }
+    else if (cv.valueType == CachedValue::HASH)
+    {
+      const auto& hash = std::get<HashValue>(cv.value);
+      type = FBT_MAP;
+      size = hash.fields.size();
+      bytes = hash.bytes();
+    }
+    else
+    {
+      std::visit([&type, &bytes](const auto& v)
+      {
+        using T = std::decay_t<decltype(v)>;
+
+        bytes = sizeof(T);
+
+        if constexpr (std::is_same_v<T, fcbool>)
+          type = FBT_BOOL;
+        else if constexpr (std::is_floating_point_v<T>)
+          type = FBT_FLOAT;
+        else if constexpr (std::is_signed_v<T>)
+          type = FBT_INT;
+        else
+          type = FBT_UINT;
+      },
+      std::get<FixedValue>(cv.value).value);
+    }
+
+    fb.Map(key, [&]
+    {
+      fb.UInt("type", type);
+      fb.UInt("size", size);
+      fb.UInt("bytes", bytes);
+      fb.UInt("version", cv.version);
+    });
+  }
+
+
+  void CacheMap::info (const KeyVector& keys, FlexBuilder& fb) const
+  {
+    fb.Map([&]
+    {
+      for (const auto& key : keys)
+      {
+        if (const auto& it = m_map.find(KeyView{key->string_view()}); it != m_map.cend())
+          valueInfo(fb, key->c_str(), it->second);
+      }
+    });
+  }
+
+
+  void CacheMap::info (FlexBuilder& fb) const
+  {
+    fb.Map([&]
+    {
+      for (const auto& [key, cachedValue] : m_map)
+        valueInfo(fb, key.c_str(), cachedValue);
+    });
+  }
+
+
+  template<typename T>
+  static void aggregateScalars (FlexBuilder& fb, const char * key, const std::uint8_t * data, const std::size_t size, const Aggregation& agg)
+  {
+    using enum fc::request::AggregateOp;
+
+    switch (agg.op)
+    {
+      case AggregateOp_Sum:
+        if constexpr (std::is_floating_point_v<T>)
+          fb.Double(key, aggregate::sum<T>(data, size));
+        else
+        {
+          // a sum outside T's range is returned as a double rather than truncated
+          if (const auto total = aggregate::sum<T>(data, size); total < std::numeric_limits<T>::min() || total > std::numeric_limits<T>::max())
+            fb.Double(key, static_cast<double>(total));
+          else if constexpr (std::is_signed_v<T>)
+            fb.Int(key, static_cast<T>(total));
+          else
+            fb.UInt(key, static_cast<T>(total));
+        }
+      break;
+
+      case AggregateOp_Min:
+      case AggregateOp_Max:
+        if (size)
+        {
+          const auto v = agg.op == AggregateOp_Min ? aggregate::minMax<T, true>(data, size) : aggregate::minMax<T, false>(data, size);
+
+          if constexpr (std::is_floating_point_v<T>)
+            fb.Float(key, v);
+          else if constexpr (std::is_signed_v<T>)
+            fb.Int(key, v);
+          else
+            fb.UInt(key, v);
+        }
+      break;
+
+      case AggregateOp_Mean:
+        if (size)
+          fb.Double(key, static_cast<double>(aggregate::sum<T>(data, size)) / static_cast<double>(size));
+      break;
+
+      case AggregateOp_CountAbove:
+        fb.UInt(key, aggregate::countAbove<T>(data, size, agg.threshold));
+      break;
+
+      case AggregateOp_Dot:
+        if (agg.operand.size() == size)
+          fb.Double(key, aggregate::dot<T>(data, size, agg.operand));
+      break;
+    }
+  }
+
+
+  void CacheMap::aggregateValue (FlexBuilder& fb, const char * key, const CachedValue& cv, const Aggregation& agg)
+  {
+    if (cv.valueType != CachedValue::VEC)
+      return;
+    
+    const auto& vv = std::get<VectorValue>(cv.value);
+
+    if (isEncodedValue(vv))
+      return;
+
+    switch (vv.type)
+    {
+      case FBT_VECTOR_INT:
+        aggregateScalars<fcint>(fb, key, vv.data.data(), vv.data.size() / sizeof(fcint), agg);
+      break;
+
+      case FBT_VECTOR_UINT:
+        aggregateScalars<fcuint>(fb, key, vv.data.data(), vv.data.size() / sizeof(fcuint), agg);
+      break;
+
+      case FBT_VECTOR_FLOAT:
+        aggregateScalars<fcfloat>(fb, key, vv.data.data(), vv.data.size() / sizeof(fcfloat), agg);
+      break;
+
+      default:
+      break;
+    }
+  }
+
+
+  void CacheMap::aggregate (const KeyVector& keys, const Aggregation& agg, FlexBuilder& fb) const
+  {
+    fb.Map([&]
+    {
+      for (const auto& key : keys)
+      {
+        if (const auto& it = m_map.find(KeyView{key->string_view()}); it != m_map.cend())
+          aggregateValue(fb, key->c_str(), it->second, agg);
+      }
+    });
+  }
+
+
+  void CacheMap::aggregate (const Aggregation& agg, FlexBuilder& fb) const
+  {
+    fb.Map([&]
+    {
+      for (const auto& [key, cachedValue] : m_map)
+        aggregateValue(fb, key.c_str(), cachedValue, agg);
+    });
+  }
+
+
+  void CacheMap::extractSlice (FlexBuilder& fb, const char * key, const VectorValue& vv, const flexbuffers::Reference& slice)
+  {
+    if (isEncodedValue(vv) || isCompressedValue(vv))
+    {
+      vv.extract(fb, key, vv);
+      return;
+    }
+
+    std::size_t begin{0}, end{0};
+
+    // an invalid slice returns an empty value of the same type
+    if (!sliceToIndices(slice, valueSize(vv), begin, end))
+      begin = end = 0;
+
+    switch (vv.type)
+    {
+      case FBT_STRING:
+        fb.Key(key);
+        fb.String(reinterpret_cast<const char *>(vv.data.data()) + begin, end - begin);
+      break;
+
+      case FBT_BLOB:
+        fb.Key(key);
+        fb.Blob(vv.data.data() + sizeof(fcblobsize) + begin, end - begin);
+      break;
+
+      case FBT_VECTOR_INT:
+        toTypedVector<fcint>(fb, key, vv, begin, end);
+      break;
+
+      case FBT_VECTOR_UINT:
+        toTypedVector<fcuint>(fb, key, vv, begin, end);
+      break;
+
+      case FBT_VECTOR_FLOAT:
+        toTypedVector<fcfloat>(fb, key, vv, begin, end);
+      break;
+
+      case FBT_VECTOR_BOOL:
+        toTypedVector<fcbool>(fb, key, vv, begin, end);
+      break;
+
+      case FBT_VECTOR_KEY:
+      {
+        const char * buffer = reinterpret_cast<const char*>(vv.data.data());
+
+        fb.TypedVector(key, [&fb, buffer, size = vv.data.size(), begin, end]
+        {
+          for (std::size_t i = 0, element = 0 ; i < size && element < end ; ++element)
+          {
+            const std::string_view sv{buffer+i};
+
+            if (element >= begin)
+              fb.String(sv.data());
+
+            i += sv.size()+1;
+          }
+        });
+      }
+      break;
+
+      default:
+        vv.extract(fb, key, vv);
+      break;
+    }
+  }
+
+
+  std::uint64_t CacheMap::scan (FlexBuilder& fb, const std::uint64_t cursor, const std::size_t count, const std::string_view pattern, const bool keysOnly) const
+  {
+    const auto& entries = m_map.values();
+    const auto begin = std::min<std::size_t>(cursor, entries.size());
+    const auto end = std::min<std::size_t>(begin + count, entries.size());
+
+    const auto matches = [pattern](const CachedKey& key)
+    {
+      return pattern.empty() || globMatch(pattern, key.view());
+    };
+
+    if (keysOnly)
+    {
+      fb.TypedVector([&]
+      {
+        for (std::size_t i = begin ; i < end ; ++i)
+        {
+          if (const auto& key = entries[i].first; matches(key))
+            fb.String(key.c_str());
+        }
+      });
+    }
+    else
+    {
+      fb.Map([&]
+      {
+        for (std::size_t i = begin ; i < end ; ++i)
+        {
+          const auto& [key, cachedValue] = entries[i];
+
+          if (!matches(key))
+            continue;
+
+          extract(fb, key.c_str(), cachedValue);
+        }
+      });
+    }
+
+    return end < entries.size() ? end : 0U;
+  }
+
+
+  void CacheMap::getPrefix (FlexBuilder& fb, const std::string_view prefix, const bool keysOnly, const std::size_t limit) const
+  {
+    const auto end = m_index->cend();
+    const auto inRange = [&](const OrderedIndex::const_iterator it, const std::size_t n)
+    {
+      return it != end && (!limit || n < limit) && it->starts_with(prefix);
+    };
+
+    if (keysOnly)
+    {
+      fb.TypedVector([&]
+      {
+        std::size_t n{0};
+        for (auto it = m_index->lower_bound(prefix) ; inRange(it, n) ; ++it, ++n)
+          fb.String(it->data(), it->size());
+      });
+    }
+    else
+    {
+      fb.Map([&]
+      {
+        std::size_t n{0};
+        for (auto it = m_index->lower_bound(prefix) ; inRange(it, n) ; ++it, ++n)
+        {
+          const auto& [key, cachedValue] = *m_map.find(KeyView{*it});
+
+          extract(fb, key.c_str(), cachedValue);
+        }
+      });
+    }
+  }
+
+
+  void CacheMap::rangeKeys (FlexBuilder& fb, const std::string_view start, const std::string_view end, const std::size_t limit) const
+  {
+    const bool empty = !end.empty() && start >= end;
+    const auto first = empty ? m_index->cend() : m_index->lower_bound(start);
+    const auto last = empty || end.empty() ? m_index->cend() : m_index->lower_bound(end);
+
+    fb.TypedVector([&]
+    {
+      std::size_t n{0};
+      for (auto it = first ; it != last && (!limit || n < limit) ; ++it, ++n)
+        fb.String(it->data(), it->size());
+    });
+  }
+}
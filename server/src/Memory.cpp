@@ -0,0 +1,103 @@
+#include <fc/Memory.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <numeric>
+#include <vector>
+#include <unistd.h>
+
+
+namespace fc
+{
+  bool AllocHistogram::load(const std::filesystem::path& path)
+  {
+    std::ifstream file{path};
+
+    if (!file)
+      return false;
+
+    for (std::size_t bucket{0}, count{0} ; file >> bucket >> count ; )
+    {
+      if (bucket < Buckets)
+        m_counts[bucket] += count;
+    }
+
+    return true;
+  }
+
+
+  bool AllocHistogram::save(const std::filesystem::path& path) const
+  {
+    std::ofstream file{path, std::ios::trunc};
+
+    for (std::size_t bucket = 0 ; file && bucket < Buckets ; ++bucket)
+    {
+      if (m_counts[bucket])
+        file << bucket << ' ' << m_counts[bucket] << '\n';
+    }
+
+    return file.good();
+  }
+
+
+  std::optional<std::pmr::pool_options> AllocHistogram::deriveOptions() const
+  {
+    static constexpr std::size_t ChunkSize = 64U * 1024U;
+    static constexpr std::size_t MinBlock = 64U;
+    static constexpr std::size_t MaxBlock = 1024U * 1024U;
+
+    const auto total = std::accumulate(m_counts.cbegin(), m_counts.cend(), std::uint64_t{0});
+
+    if (total == 0)
+      return {};
+
+    std::size_t largestBucket{0};
+    
+    for (std::uint64_t cumulative{0} ; largestBucket < Buckets ; ++largestBucket)
+    {
+      cumulative += m_counts[largestBucket];
+      if (cumulative * 100 >= total * 99)
+        break;
+    }
+
+    const auto modeBucket = std::distance(m_counts.cbegin(), std::max_element(m_counts.cbegin(), m_counts.cend()));
+    const std::size_t modeSize = std::size_t{1} << modeBucket;
+
+    std::pmr::pool_options options;
+    options.largest_required_pool_block = std::clamp<std::size_t>(std::size_t{1} << largestBucket, MinBlock, MaxBlock);
+    options.max_blocks_per_chunk = std::clamp<std::size_t>(ChunkSize / modeSize, 16U, 4096U);
+    return options;
+  }
+
+  
+  bool prefault(const std::size_t bytes)
+  {
+    // below glibc's minimum mmap threshold, so blocks are from the heap: an mmap()'d block is unmapped when freed
+    static constexpr std::size_t BlockSize = 64U * 1024U;
+
+    const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+    std::vector<void *> blocks;
+    blocks.reserve(bytes / BlockSize + 1);
+
+    for (std::size_t allocated = 0 ; allocated < bytes ; allocated += BlockSize)
+    {
+      auto block = static_cast<volatile char *>(std::malloc(BlockSize));
+      
+      if (!block)
+        break;
+
+      for (std::size_t page = 0 ; page < BlockSize ; page += pageSize)
+        block[page] = 0;
+
+      blocks.push_back(const_cast<char *>(block));
+    }
+
+    // The last block is kept, so the freed blocks are below it rather than at the top of the heap,
+    // which free() would return to the OS.
+    for (std::size_t i = 0 ; i + 1 < blocks.size() ; ++i)
+      std::free(blocks[i]);
+
+    return blocks.size() * BlockSize >= bytes;
+  }
+}
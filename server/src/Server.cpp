@@ -1,5 +1,6 @@
 #include <fc/Server.hpp>
 #include <fc/FlatBuffers.hpp>
+#include <algorithm>
 #include <latch>
 
 
@@ -11,8 +12,9 @@ namespace fc
 
     try
     {
-      // if (m_monitorTimer)
-      //   us_timer_close(m_monitorTimer);
+      // stop() isn't called on the loop thread, so the timer is closed on the loop
+      if (m_monitorTimer && m_loop)
+        m_loop->defer([timer = m_monitorTimer]{ us_timer_close(timer); });
 
       for (auto ws : m_clients)
         ws->end(1000); // calls wsApp.close()
@@ -28,18 +30,21 @@ namespace fc
 
     m_clients.clear();
     m_sockets.clear();
-    //m_monitorTimer = nullptr;
+    m_monitorTimer = nullptr;
   }
 
 
-  bool Server::init()
+  bool Server::init(const bool lazyFree, const bool defrag, const std::size_t maxBlobSize)
   {
     bool init = true;
 
     try
     {
-      m_kvHandler = std::make_shared<KvHandler>();
-      m_listHandler = std::make_shared<ListHandler>();
+      m_defrag = defrag;
+      m_lazyFree = std::make_unique<LazyFree>(lazyFree);
+      m_workers = std::make_unique<WorkerPool>(std::max(std::thread::hardware_concurrency(), 1U));
+      m_kvHandler = std::make_shared<KvHandler>(*m_lazyFree, *m_workers, maxBlobSize);
+      m_listHandler = std::make_shared<ListHandler>(*m_lazyFree);
     }
     catch(const std::exception& e)
     {
@@ -58,6 +63,9 @@ namespace fc
 
     auto listen = [this, ip, port, &listening, &startLatch, maxPayload]()
     {
+      // before startLatch is counted down, so visible to stop()
+      m_loop = uWS::Loop::get();
+
       auto wsApp = uWS::App().ws<WsSession>("/*",
       {
         // settings
@@ -68,6 +76,7 @@ namespace fc
         // handlers
         .open = [this](WebSocket * ws)
         {
+          ws->getUserData()->id = m_nextSessionId++;
           m_clients.insert(ws);
         },          
         .message = [this](WebSocket * ws, std::string_view message, uWS::OpCode opCode)
@@ -89,6 +98,9 @@ namespace fc
         {
           ws->getUserData()->connected = false;
 
+          // uploads the client didn't commit or abort
+          m_kvHandler->endSession(ws->getUserData()->id);
+
           // when we shutdown, we have to call ws->end() to close each client otherwise uWS loop doesn't return,
           // but when we call ws->end(), this lambda is called, so we need to avoid mutex deadlock with this flag
           if (m_run)
@@ -111,6 +123,19 @@ namespace fc
 
       if (!wsApp.constructorFailed())
       {
+        if (m_defrag)
+        {
+          // fallthrough so the timer doesn't keep the loop running at shutdown
+          m_monitorTimer = us_create_timer(reinterpret_cast<us_loop_t *>(m_loop), 1, sizeof(TimerData));
+          new (us_timer_ext(m_monitorTimer)) TimerData{.server = this};
+
+          us_timer_set(m_monitorTimer, [](us_timer_t * timer)
+          {
+            static_cast<TimerData *>(us_timer_ext(timer))->server->onMonitorTimer();
+          },
+          MonitorIntervalMs, MonitorIntervalMs);
+        }
+
         wsApp.run();
       }
     };
@@ -150,6 +175,8 @@ namespace fc
   { 
     FlatBuilder fbb;
 
+    m_lastMessage = std::chrono::steady_clock::now();
+
     if (opCode != uWS::OpCode::BINARY)
       sendFailure(ws, fbb, fc::response::Status::Status_ParseError);
     else
@@ -174,6 +201,12 @@ namespace fc
             handleList(ws, fbb, *request);
           }
           break;
+
+          case fc::common::Ident_Server:
+          {
+            handleServer(ws, fbb, *request);
+          }
+          break;
           
           default:
           {
@@ -223,6 +256,127 @@ namespace fc
         callKvHandler<fc::request::KVClearSet>(fbb, request);
       break;
 
+      case RequestBody_KVGroupInfo:
+        callKvHandler<fc::request::KVGroupInfo>(fbb, request);
+      break;
+
+      case RequestBody_KVIncr:
+        callKvHandler<fc::request::KVIncr>(fbb, request);
+      break;
+
+      case RequestBody_KVDecr:
+        callKvHandler<fc::request::KVDecr>(fbb, request);
+      break;
+
+      case RequestBody_KVAddFloat:
+        callKvHandler<fc::request::KVAddFloat>(fbb, request);
+      break;
+
+      case RequestBody_KVCas:
+        callKvHandler<fc::request::KVCas>(fbb, request);
+      break;
+
+      case RequestBody_KVAppend:
+        callKvHandler<fc::request::KVAppend>(fbb, request);
+      break;
+
+      case RequestBody_KVWriteAt:
+        callKvHandler<fc::request::KVWriteAt>(fbb, request);
+      break;
+
+      case RequestBody_KVScan:
+        callKvHandler<fc::request::KVScan>(fbb, request);
+      break;
+
+      case RequestBody_KVGroupCreate:
+        callKvHandler<fc::request::KVGroupCreate>(fbb, request);
+      break;
+
+      case RequestBody_KVGetPrefix:
+        callKvHandler<fc::request::KVGetPrefix>(fbb, request);
+      break;
+
+      case RequestBody_KVRangeKeys:
+        callKvHandler<fc::request::KVRangeKeys>(fbb, request);
+      break;
+
+      case RequestBody_KVChunkBegin:
+        // the upload belongs to the connection, so is aborted if the connection closes
+        m_kvHandler->handle(fbb, *request.body_as<fc::request::KVChunkBegin>(), ws->getUserData()->id);
+      break;
+
+      case RequestBody_KVChunkAppend:
+        callKvHandler<fc::request::KVChunkAppend>(fbb, request);
+      break;
+
+      case RequestBody_KVChunkCommit:
+        callKvHandler<fc::request::KVChunkCommit>(fbb, request);
+      break;
+
+      case RequestBody_KVChunkGet:
+        callKvHandler<fc::request::KVChunkGet>(fbb, request);
+      break;
+
+      case RequestBody_KVGetGroups:
+        callKvHandler<fc::request::KVGetGroups>(fbb, request);
+      break;
+
+      case RequestBody_KVAggregate:
+        callKvHandler<fc::request::KVAggregate>(fbb, request);
+      break;
+
+      case RequestBody_KVGroupSwap:
+        callKvHandler<fc::request::KVGroupSwap>(fbb, request);
+      break;
+
+      case RequestBody_KVInfo:
+        callKvHandler<fc::request::KVInfo>(fbb, request);
+      break;
+
+      case RequestBody_KVFieldSet:
+        callKvHandler<fc::request::KVFieldSet>(fbb, request);
+      break;
+
+      case RequestBody_KVFieldGet:
+        callKvHandler<fc::request::KVFieldGet>(fbb, request);
+      break;
+
+      case RequestBody_KVFieldIncr:
+        callKvHandler<fc::request::KVFieldIncr>(fbb, request);
+      break;
+
+      case RequestBody_KVBitSet:
+        callKvHandler<fc::request::KVBitSet>(fbb, request);
+      break;
+
+      case RequestBody_KVBitTest:
+        callKvHandler<fc::request::KVBitTest>(fbb, request);
+      break;
+
+      case RequestBody_KVBitCount:
+        callKvHandler<fc::request::KVBitCount>(fbb, request);
+      break;
+
+      case RequestBody_KVBitOp:
+        callKvHandler<fc::request::KVBitOp>(fbb, request);
+      break;
+
+      case RequestBody_KVHllAdd:
+        callKvHandler<fc::request::KVHllAdd>(fbb, request);
+      break;
+
+      case RequestBody_KVHllCount:
+        callKvHandler<fc::request::KVHllCount>(fbb, request);
+      break;
+
+      case RequestBody_KVHllMerge:
+        callKvHandler<fc::request::KVHllMerge>(fbb, request);
+      break;
+
+      case RequestBody_KVNearest:
+        callKvHandler<fc::request::KVNearest>(fbb, request);
+      break;
+
       default:
       {
         PLOGE << "KV command unknown";
@@ -292,6 +446,62 @@ namespace fc
   }
 
 
+  void Server::handleServer(WebSocket * ws, FlatBuilder& fbb, const fc::request::Request& request)
+  {
+    switch (request.body_type())
+    {
+      case RequestBody_ServerInfo:
+        serverInfo(fbb);
+      break;
+
+      default:
+      {
+        PLOGE << "Server command unknown";
+        createEmptyBodyResponse(fbb, Status_CommandUnknown, ResponseBody_NONE);
+      }        
+      break;
+    }
+
+    send(ws, fbb);
+  }
+
+
+  void Server::serverInfo(FlatBuilder& fbb)
+  {
+    try
+    {
+      FlexBuilder flxb;
+
+      flxb.Map([this, &flxb]
+      {
+        m_lazyFree->metrics(flxb);
+        m_kvHandler->metrics(flxb);
+      });
+
+      flxb.Finish();
+
+      const auto vec = fbb.CreateVector(flxb.GetBuffer());
+      const auto body = fc::response::CreateServerInfo(fbb, vec);
+
+      auto rsp = fc::response::CreateResponse(fbb, Status_Ok, ResponseBody_ServerInfo, body.Union());
+      fbb.Finish(rsp);
+    }
+    catch(const std::exception& e)
+    {
+      PLOGE << __FUNCTION__ << ":" << e.what();
+      createEmptyBodyResponse(fbb, Status_Fail, ResponseBody_ServerInfo);
+    }
+  }
+
+
+  void Server::onMonitorTimer()
+  {
+    // only defrag if no requests since the previous tick
+    if (m_defrag && std::chrono::steady_clock::now() - m_lastMessage >= std::chrono::milliseconds{MonitorIntervalMs})
+      m_kvHandler->defrag();
+  }
+
+
   void Server::sendFailure (WebSocket * ws, FlatBuilder& fbb, const fc::response::Status status)
   {
     const auto rsp = fc::response::CreateResponse(fbb, status);
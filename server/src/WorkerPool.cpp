@@ -0,0 +1,68 @@
+#include <fc/WorkerPool.hpp>
+
+
+namespace fc
+{
+  WorkerPool::WorkerPool(const std::size_t threads)
+  {
+    for (std::size_t part = 1 ; part < threads ; ++part)
+      m_threads.emplace_back([this, part](std::stop_token stop){ work(stop, part); });
+  }
+
+
+  void WorkerPool::run (const std::size_t parts, const std::function<void(std::size_t)>& task)
+  {
+    if (parts <= 1)
+    {
+      task(0);
+      return;
+    }
+
+    {
+      std::scoped_lock lock{m_mux};
+      m_task = &task;
+      m_parts = parts;
+      m_remaining = parts - 1;
+      ++m_job;
+    }
+
+    m_start.notify_all();
+
+    task(0);
+
+    std::unique_lock lock{m_mux};
+    m_done.wait(lock, [this]{ return m_remaining == 0; });
+    m_task = nullptr;
+  }
+
+
+  void WorkerPool::work (std::stop_token stop, const std::size_t part)
+  {
+    std::uint64_t job{0};
+
+    while (!stop.stop_requested())
+    {
+      const std::function<void(std::size_t)> * task{nullptr};
+
+      {
+        std::unique_lock lock{m_mux};
+        if (!m_start.wait(lock, stop, [this, job]{ return m_job != job; }))
+          break;
+
+        // a thread without a part in this job waits for the next
+        job = m_job;
+        if (part < m_parts)
+          task = m_task;
+      }
+
+      if (task)
+      {
+        (*task)(part);
+
+        std::scoped_lock lock{m_mux};
+        if (--m_remaining == 0)
+          m_done.notify_one();
+      }
+    }
+  }
+}